@@ -9,6 +9,39 @@
 #include "FangOost.h"
 #include "Newton.h"
 #include <tuple>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <complex>
+#include <chrono>
+#include <exception>
+#include <type_traits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+/**
+    Runtime CPU dispatch for the summation kernels.  GCC emits one clone of 
+    the function per target and picks the best one at load time, so a single
+    binary uses AVX-512 or AVX2 where available.  target_clones needs GCC 6
+    and ifunc support, so elsewhere (g++-5, Mach-O) the vector kernels are 
+    built once for the default target.
+*/
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+    #define CFDISTUTILITIES_SIMD
+    #if __GNUC__>=6 && defined(__linux__)
+        #define CFDISTUTILITIES_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+    #else
+        #define CFDISTUTILITIES_TARGET_CLONES
+    #endif
+    #include <cstring>
+#endif
 
 namespace cfdistutilities {
     /**
@@ -20,7 +53,7 @@ namespace cfdistutilities {
     auto VkCDF(const Number& u, const X& x, const Number& a, const Number& b, const Index& k){
         return k==0?x-a:sin((x-a)*u)/u;
     }
-    
+
     /**helper functions*/
     template<typename Number>
     auto powTwo(const Number& x){
@@ -41,118 +74,2795 @@ namespace cfdistutilities {
         auto uDen=1.0/u;
         return k==0?diffPow(x, a):x*sin(arg)*uDen+powTwo(uDen)*(cos(arg)-1.0);
     }
-    //this is a helper function.  It bisects until it finds the point such that the CDF is equal to alpha 
+    /**
+        Non-owning view of contiguous discrete CF coefficients, in the manner
+        of a span.  Vectors convert to it implicitly.  computeVaRDiscrete, 
+        computeESDiscrete, computeELDiscrete and computeCDFAtPoint on a view 
+        (or on a vector, which is viewed rather than copied) perform no heap
+        allocation.
+    */
+    template<typename Number>
+    class DiscreteCFView{
+        const Number* data_;
+        std::size_t size_;
+    public:
+        DiscreteCFView(const Number* data, std::size_t size):data_(data), size_(size){}
+        DiscreteCFView(const std::vector<Number>& discreteCF):data_(discreteCF.data()), size_(discreteCF.size()){}
+        const Number* data() const{
+            return data_;
+        }
+        std::size_t size() const{
+            return size_;
+        }
+        const Number& operator[](std::size_t index) const{
+            return data_[index];
+        }
+        const Number* begin() const{
+            return data_;
+        }
+        const Number* end() const{
+            return data_+size_;
+        }
+    };
+    template<typename Number>
+    auto makeView(const std::vector<Number>& discreteCF){
+        return DiscreteCFView<Number>(discreteCF);
+    }
+    /**
+        Contiguous double coefficients are passed to the kernels as views; 
+        anything else is passed through unchanged
+    */
+    template<typename CFDiscrete>
+    const CFDiscrete& viewOf(const CFDiscrete& discreteCF){
+        return discreteCF;
+    }
+    inline DiscreteCFView<double> viewOf(const std::vector<double>& discreteCF){
+        return DiscreteCFView<double>(discreteCF);
+    }
+    inline DiscreteCFView<double> viewOf(const DiscreteCFView<double>& discreteCF){
+        return discreteCF;
+    }
+
+    /**
+        Number of terms between exact evaluations of sin and cos in 
+        computePointSums.  The rotation recurrence loses roughly one ulp per 
+        term, so re-seeding keeps the error near machine precision.
+    */
+    constexpr std::size_t reseedInterval=64;
+
+    /**
+        The three sums over k>=1 from which the CDF, density and partial
+        expectation at a point all follow:
+        sinOverU=sum f_k sin((x-a)u_k)/u_k
+        cosine=sum f_k cos((x-a)u_k)
+        cosMinusOneOverUSquared=sum f_k (cos((x-a)u_k)-1)/u_k^2
+    */
+    template<typename Number>
+    struct PointSums{
+        Number sinOverU;
+        Number cosine;
+        Number cosMinusOneOverUSquared;
+    };
+
+    /**
+        Computes PointSums at xValue for any indexable discrete CF.  Since 
+        u_k=k*du the arguments (x-a)u_k are multiples of theta=(x-a)du, so 
+        sin and cos are generated by rotating through theta rather than by 
+        calling sin and cos for every term.
+    */
     template<typename Number, typename CFDiscrete>
-    auto computeVaRHelper(const Number& alpha, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2){
+    auto computePointSums(const Number& xValue, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF){
+        const Number du=fangoost::computeDU(xMin, xMax);
+        const Number theta=(xValue-xMin)*du;
+        const Number sinTheta=sin(theta);
+        const Number cosTheta=cos(theta);
+        const std::size_t numU=discreteCF.size();
+        PointSums<Number> sums={0.0, 0.0, 0.0};
+        Number sinArg=sinTheta;
+        Number cosArg=cosTheta;
+        for(std::size_t k=1; k<numU; ++k){
+            if(k%reseedInterval==0){
+                sinArg=sin(k*theta);
+                cosArg=cos(k*theta);
+            }
+            const Number uDen=1.0/(k*du);
+            sums.sinOverU+=discreteCF[k]*sinArg*uDen;
+            sums.cosine+=discreteCF[k]*cosArg;
+            sums.cosMinusOneOverUSquared+=discreteCF[k]*(cosArg-1.0)*uDen*uDen;
+            const Number nextSin=sinArg*cosTheta+cosArg*sinTheta;
+            cosArg=cosArg*cosTheta-sinArg*sinTheta;
+            sinArg=nextSin;
+        }
+        return sums;
+    }
+
+    /**
+        Number of terms processed together by computePointSumsKernel: one 
+        AVX-512 register or two AVX2 registers of doubles.
+    */
+    constexpr std::size_t simdLanes=8;
+    static_assert(reseedInterval%simdLanes==0, "re-seeding must happen on a block boundary");
 
-        return -newton::bisect([&](const auto& pointInX){
+    /**
+        1/k for k<numTabulatedReciprocals, so that the kernel multiplies by 
+        1/u_k=(1/k)(1/du) instead of dividing.  The table is static storage,
+        filled once on first use, and never allocates.
+    */
+    constexpr std::size_t numTabulatedReciprocals=16384;
+    inline const double* reciprocalTable(){
+        alignas(64) static double table[numTabulatedReciprocals];
+        static const bool isFilled=[](){
+            table[0]=0.0;
+            for(std::size_t k=1; k<numTabulatedReciprocals; ++k){
+                table[k]=1.0/k;
+            }
+            return true;
+        }();
+        (void)isFilled;
+        return table;
+    }
 
-            return fangoost::computeExpectationPointDiscrete(pointInX, xMin, xMax, std::move(discreteCF), [&](const auto& u, const auto& x, const auto& index){
-                return VkCDF(u, x, xMin, xMax, index);
-            })-alpha;
-        }, xMin, xMax, prec1, prec2);
+    #ifdef CFDISTUTILITIES_SIMD
+    typedef double SimdDouble __attribute__((vector_size(simdLanes*sizeof(double))));
+
+    /**
+        Vectorized PointSums over terms k=1..numU-1 of a contiguous discrete CF.
+        Lane l of a block starting at k0 holds sin and cos of (k0+l)theta and
+        every lane rotates through simdLanes*theta, so the block loop contains
+        no transcendental calls and no divisions.  The k=0 term is left to the
+        caller.  Lanes are re-seeded every reseedInterval terms from exact 
+        sin and cos of k0*theta.  The result is written to sums as sinOverU, 
+        cosine, cosMinusOneOverUSquared.
+    */
+    CFDISTUTILITIES_TARGET_CLONES
+    inline void computePointSumsKernel(const double* discreteCF, std::size_t numU, double theta, double du, double* sums){
+        const double* reciprocals=reciprocalTable();
+        const double duInverse=1.0/du;
+        const double sinTheta=sin(theta);
+        const double cosTheta=cos(theta);
+        //sin and cos of l*theta for each lane
+        SimdDouble laneIndex, sinOffset, cosOffset;
+        double sinLane=0.0;
+        double cosLane=1.0;
+        for(std::size_t l=0; l<simdLanes; ++l){
+            laneIndex[l]=l;
+            sinOffset[l]=sinLane;
+            cosOffset[l]=cosLane;
+            const double nextSin=sinLane*cosTheta+cosLane*sinTheta;
+            cosLane=cosLane*cosTheta-sinLane*sinTheta;
+            sinLane=nextSin;
+        }
+        //after the loop sinLane and cosLane hold sin and cos of simdLanes*theta
+        const double sinStep=sinLane;
+        const double cosStep=cosLane;
+        SimdDouble sinOverU={}, cosine={}, cosMinusOne={}, sinArg={}, cosArg={};
+        const std::size_t numBlocks=numU>1?(numU-1)/simdLanes:0;
+        for(std::size_t block=0; block<numBlocks; ++block){
+            const std::size_t k0=1+block*simdLanes;
+            if((block*simdLanes)%reseedInterval==0){
+                const double sinK0=sin(k0*theta);
+                const double cosK0=cos(k0*theta);
+                sinArg=sinK0*cosOffset+cosK0*sinOffset;
+                cosArg=cosK0*cosOffset-sinK0*sinOffset;
+            }
+            SimdDouble coefficients;
+            std::memcpy(&coefficients, discreteCF+k0, sizeof(coefficients));
+            SimdDouble uDen;
+            if(k0+simdLanes<=numTabulatedReciprocals){
+                std::memcpy(&uDen, reciprocals+k0, sizeof(uDen));
+                uDen*=duInverse;
+            }
+            else{
+                uDen=1.0/((static_cast<double>(k0)+laneIndex)*du);
+            }
+            sinOverU+=coefficients*sinArg*uDen;
+            cosine+=coefficients*cosArg;
+            cosMinusOne+=coefficients*(cosArg-1.0)*uDen*uDen;
+            const SimdDouble nextSin=sinArg*cosStep+cosArg*sinStep;
+            cosArg=cosArg*cosStep-sinArg*sinStep;
+            sinArg=nextSin;
+        }
+        double totals[3]={0.0, 0.0, 0.0};
+        for(std::size_t l=0; l<simdLanes; ++l){
+            totals[0]+=sinOverU[l];
+            totals[1]+=cosine[l];
+            totals[2]+=cosMinusOne[l];
+        }
+        //remaining terms which do not fill a block
+        for(std::size_t k=1+numBlocks*simdLanes; k<numU; ++k){
+            const double arg=k*theta;
+            const double uDen=1.0/(k*du);
+            const double cosK=cos(arg);
+            totals[0]+=discreteCF[k]*sin(arg)*uDen;
+            totals[1]+=discreteCF[k]*cosK;
+            totals[2]+=discreteCF[k]*(cosK-1.0)*uDen*uDen;
+        }
+        sums[0]=totals[0];
+        sums[1]=totals[1];
+        sums[2]=totals[2];
     }
 
-    template<typename Number, typename CFDiscrete, typename Index>
-    auto computeCDF(const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
-        return fangoost::computeExpectationDiscrete(numXDiscrete, xMin, xMax, std::move(discreteCF), [&](const auto& u, const auto& x, const auto& index){
-            return VkCDF(u, x, xMin, xMax, index);
-        });
+    /**
+        Contiguous double precision coefficients use the vectorized kernel.
+    */
+    inline PointSums<double> computePointSums(const double& xValue, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF){
+        const double du=fangoost::computeDU(xMin, xMax);
+        double sums[3];
+        computePointSumsKernel(discreteCF.data(), discreteCF.size(), (xValue-xMin)*du, du, sums);
+        return PointSums<double>{sums[0], sums[1], sums[2]};
     }
-    template<typename Number, typename CF, typename Index>
-    auto computeCDF(const Index& numXDiscrete, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
-        return fangoost::computeExpectation(numXDiscrete, numU, xMin, xMax, std::move(cf), [&](const auto& u, const auto& x, const auto& index){
-            return VkCDF(u, x, xMin, xMax, index);
-        });
+
+    /**
+        sinOverU and cosMinusOneOverUSquared of PointSums at simdLanes points
+        at once, one point per lane, with theta[l]=(x_l-xMin)du.  Each lane
+        rotates through its own theta, re-seeded every reseedInterval terms,
+        and the coefficient and 1/u_k are shared by all lanes.  The k=0 term
+        is left to the caller.
+    */
+    CFDISTUTILITIES_TARGET_CLONES
+    inline void computePointSumsLanesKernel(const double* discreteCF, std::size_t numU, const double* theta, double du, double* sinOverUOut, double* cosMinusOneOverUSquaredOut){
+        const double* reciprocals=reciprocalTable();
+        const double duInverse=1.0/du;
+        SimdDouble sinStep, cosStep;
+        for(std::size_t l=0; l<simdLanes; ++l){
+            sinStep[l]=sin(theta[l]);
+            cosStep[l]=cos(theta[l]);
+        }
+        SimdDouble sinOverU={}, cosMinusOne={}, sinArg={}, cosArg={};
+        for(std::size_t k=1; k<numU; ++k){
+            if((k-1)%reseedInterval==0){
+                for(std::size_t l=0; l<simdLanes; ++l){
+                    sinArg[l]=sin(k*theta[l]);
+                    cosArg[l]=cos(k*theta[l]);
+                }
+            }
+            const double uDen=k<numTabulatedReciprocals?reciprocals[k]*duInverse:1.0/(k*du);
+            const double sinCoefficient=discreteCF[k]*uDen;
+            const double cosCoefficient=sinCoefficient*uDen;
+            sinOverU+=sinCoefficient*sinArg;
+            cosMinusOne+=cosCoefficient*(cosArg-1.0);
+            const SimdDouble nextSin=sinArg*cosStep+cosArg*sinStep;
+            cosArg=cosArg*cosStep-sinArg*sinStep;
+            sinArg=nextSin;
+        }
+        std::memcpy(sinOverUOut, &sinOverU, sizeof(sinOverU));
+        std::memcpy(cosMinusOneOverUSquaredOut, &cosMinusOne, sizeof(cosMinusOne));
     }
+    #endif
+
+    /**
+        CDF, density and partial expectation at a single point
+    */
+    template<typename Number>
+    struct PointEvaluation{
+        Number cdf;
+        Number pdf;
+        Number expectation;
+    };
+
+    /**
+        Evaluates the CDF, density and partial expectation at xValue in a 
+        single pass over the discrete CF.  The k=0 term is weighted by .5 
+        as in fangoost::computeExpectationPointDiscrete.
+    */
     template<typename Number, typename CFDiscrete>
-    auto computeCDFAtPoint(const Number& xValue, const Number& xMin, const Number&xMax, CFDiscrete&& cfDiscrete){
-        return fangoost::computeExpectationPointDiscrete(xValue, xMin, xMax, std::move(cfDiscrete), [&](const auto& u, const auto& x, const auto& index){
-            return VkCDF(u, x, xMin, xMax, index);
-        });
+    auto evaluatePoint(const Number& xValue, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        const auto sums=computePointSums(xValue, xMin, xMax, viewOf(discreteCF));
+        const Number halfFirst=discreteCF.size()>0?.5*discreteCF[0]:0.0;
+        return PointEvaluation<Number>{
+            halfFirst*(xValue-xMin)+sums.sinOverU,
+            halfFirst+sums.cosine,
+            halfFirst*diffPow(xValue, xMin)+xValue*sums.sinOverU+sums.cosMinusOneOverUSquared
+        };
     }
-    template<typename Number, typename CF, typename Index>
-    auto computeCDFAtPoint(const Number& xValue,const Index& numU, const Number& xMin, const Number&xMax, CF&& cf){
-        return fangoost::computeExpectationPoint(xValue, xMin, xMax, numU, std::move(cf), [&](const auto& u, const auto& x, const auto& index){
-            return VkCDF(u, x, xMin, xMax, index);
+    /**
+        Options for choosing numU from the decay of the coefficients.  The u 
+        grid starts at initialNumU terms and doubles, never past maxNumU, 
+        until every term in the last quarter of the grid has 
+        |Re(phi(u_k)exp(-i u_k xMin))|<tolerance.  The options are not 
+        modified, so one instance can be shared between threads.  The numU 
+        chosen is the size of the discrete CF returned by 
+        computeDiscreteCFAdaptive, and the entry points taking a SolverStats
+        report it as numCoefficients.  Every entry point also writes it to 
+        the caller's variable given with reportingTo, e.g. 
+        computeVaR(alpha, prec, xMin, xMax, adaptive.reportingTo(&numU), cf);
+        threads sharing options should each report to their own variable.
+    */
+    struct AdaptiveNumU{
+        double tolerance;
+        std::size_t initialNumU;
+        std::size_t maxNumU;
+        std::size_t* chosenNumU;
+        explicit AdaptiveNumU(double tolerance_, std::size_t initialNumU_=16, std::size_t maxNumU_=4096):
+            tolerance(tolerance_), initialNumU(initialNumU_), maxNumU(maxNumU_), chosenNumU(nullptr){}
+        AdaptiveNumU reportingTo(std::size_t* chosenNumU_) const{
+            AdaptiveNumU adaptive=*this;
+            adaptive.chosenNumU=chosenNumU_;
+            return adaptive;
+        }
+        void report(std::size_t numU) const{
+            if(chosenNumU){
+                *chosenNumU=numU;
+            }
+        }
+    };
+
+    /**
+        Stats sink which records nothing.  Every member is an empty inline 
+        function, so the instrumented code paths compile to the same code as
+        without instrumentation.
+    */
+    struct NoStats{
+        int startStage() const{
+            return 0;
+        }
+        void endDomain(int, std::size_t) const{}
+        void endDiscreteCF(int, std::size_t) const{}
+        void addIteration() const{}
+        void endSolver(int, double) const{}
+    };
+    /**
+        Stats sink for the entry points which take one: CF evaluations, 
+        number of coefficients, root finder iterations (every evaluation of
+        the CDF, including those at the ends of the starting bracket, so 
+        that the methods compare on the same work), the final bracket width
+        of the bracketing solvers and the time spent choosing the domain, 
+        building the discrete CF and solving.  Counts and times add up over
+        calls.
+    */
+    struct SolverStats{
+        std::size_t cfEvaluations;
+        std::size_t numCoefficients;
+        std::size_t iterations;
+        double bracketWidth;
+        std::chrono::nanoseconds domainTime;
+        std::chrono::nanoseconds discreteCFTime;
+        std::chrono::nanoseconds solverTime;
+        SolverStats():
+            cfEvaluations(0), numCoefficients(0), iterations(0), bracketWidth(0.0), 
+            domainTime(0), discreteCFTime(0), solverTime(0){}
+        std::chrono::steady_clock::time_point startStage() const{
+            return std::chrono::steady_clock::now();
+        }
+        void endDomain(const std::chrono::steady_clock::time_point& start, std::size_t numCFEvaluations){
+            cfEvaluations+=numCFEvaluations;
+            domainTime+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start);
+        }
+        void endDiscreteCF(const std::chrono::steady_clock::time_point& start, std::size_t numTerms){
+            cfEvaluations+=numTerms;
+            numCoefficients+=numTerms;
+            discreteCFTime+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start);
+        }
+        void addIteration(){
+            ++iterations;
+        }
+        void endSolver(const std::chrono::steady_clock::time_point& start, double width){
+            bracketWidth=width;
+            solverTime+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start);
+        }
+    };
+
+    /**
+        A CF which evaluates a whole u grid per call, so that models can 
+        vectorize their complex arithmetic.  fn(u, n, real, imag) writes the
+        real and imaginary parts of phi at z=i*u[k], k=0..n-1, where u holds
+        real frequencies.  Pass a BatchCF (from makeBatchCF) in place of a 
+        CF to any entry point which takes numU.  Cumulants, and so 
+        AutoDomain and the cumulant bracket, need the CF off the imaginary 
+        axis and so still take a scalar CF.
+    */
+    template<typename Fn>
+    struct BatchCF{
+        Fn fn;
+    };
+    template<typename Fn>
+    auto makeBatchCF(Fn&& fn){
+        return BatchCF<std::decay_t<Fn> >{std::forward<Fn>(fn)};
+    }
+    /**
+        Adapter evaluating a scalar CF, which takes the complex argument z=iu,
+        as a BatchCF
+    */
+    template<typename CF>
+    auto makeBatchCFFromScalar(CF&& cf){
+        return makeBatchCF([cf](const double* u, std::size_t n, double* real, double* imag){
+            for(std::size_t k=0; k<n; ++k){
+                const std::complex<double> value=cf(std::complex<double>(0.0, u[k]));
+                real[k]=value.real();
+                imag[k]=value.imag();
+            }
         });
     }
 
+    /**
+        Appends the terms discreteCF.size() to numU-1 of the discrete CF
+    */
+    template<typename Number, typename CF>
+    void appendDiscreteCF(const Number& xMin, const Number& xMax, std::size_t numU, const CF& cf, std::vector<Number>& discreteCF){
+        const Number du=fangoost::computeDU(xMin, xMax);
+        const Number cp=fangoost::computeCP(du);
+        for(std::size_t k=discreteCF.size(); k<numU; ++k){
+            const std::complex<Number> u(0.0, k*du);
+            discreteCF.emplace_back((cf(u)*exp(-u*xMin)).real()*cp);
+        }
+    }
+    /**
+        Buffers passed to a BatchCF; they keep their capacity between calls
+    */
+    struct BatchScratch{
+        std::vector<double> u;
+        std::vector<double> real;
+        std::vector<double> imag;
+    };
+    /**
+        Re(phi(iu)exp(-iu xMin))=Re(phi)cos(u xMin)+Im(phi)sin(u xMin)
+    */
+    template<typename Number, typename Fn>
+    void appendDiscreteCF(const Number& xMin, const Number& xMax, std::size_t numU, const BatchCF<Fn>& cf, std::vector<Number>& discreteCF, BatchScratch& scratch){
+        const Number du=fangoost::computeDU(xMin, xMax);
+        const Number cp=fangoost::computeCP(du);
+        const std::size_t first=discreteCF.size();
+        const std::size_t count=numU>first?numU-first:0;
+        scratch.u.resize(count);
+        scratch.real.resize(count);
+        scratch.imag.resize(count);
+        for(std::size_t k=0; k<count; ++k){
+            scratch.u[k]=(first+k)*du;
+        }
+        cf.fn(scratch.u.data(), count, scratch.real.data(), scratch.imag.data());
+        for(std::size_t k=0; k<count; ++k){
+            const Number arg=scratch.u[k]*xMin;
+            discreteCF.emplace_back(cp*(scratch.real[k]*cos(arg)+scratch.imag[k]*sin(arg)));
+        }
+    }
+    template<typename Number, typename Fn>
+    void appendDiscreteCF(const Number& xMin, const Number& xMax, std::size_t numU, const BatchCF<Fn>& cf, std::vector<Number>& discreteCF){
+        BatchScratch scratch;
+        appendDiscreteCF(xMin, xMax, numU, cf, discreteCF, scratch);
+    }
 
-    template<typename Number, typename CFDiscrete>
-    auto computeVaRNewtonHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2){
-        return -newton::zeros([&](const auto& pointInX){
-            return fangoost::computeExpectationPointDiscrete(pointInX, xMin, xMax, std::move(discreteCF), [&](const auto& u, const auto& x, const auto& index){
-                return VkCDF(u, x, xMin, xMax, index);
-            })-alpha;
-        }, guess, prec1, prec2, 50);
+    /**
+        Discrete CF with numU chosen adaptively.  Terms already computed are
+        kept as the grid grows since u_k=k*du does not depend on numU, so the 
+        CF is evaluated exactly once per term.
+    */
+    template<typename Number>
+    bool isAdaptiveTailConverged(const AdaptiveNumU& adaptive, const std::vector<Number>& discreteCF, const Number& cp){
+        const std::size_t numU=discreteCF.size();
+        Number tailMax=0.0;
+        for(std::size_t k=numU-numU/4; k<numU; ++k){
+            tailMax=std::max(tailMax, std::abs(discreteCF[k])/cp);
+        }
+        return tailMax<adaptive.tolerance;
+    }
+    template<typename Number, typename CF>
+    auto computeDiscreteCFAdaptive(const Number& xMin, const Number& xMax, const AdaptiveNumU& adaptive, CF&& cf){
+        const Number cp=fangoost::computeCP(fangoost::computeDU(xMin, xMax));
+        const std::size_t maxNumU=std::max<std::size_t>(adaptive.maxNumU, 1);
+        std::size_t numU=std::min(std::max<std::size_t>(adaptive.initialNumU, 4), maxNumU);
+        std::vector<Number> discreteCF;
+        discreteCF.reserve(maxNumU);
+        while(true){
+            appendDiscreteCF(xMin, xMax, numU, cf, discreteCF);
+            if(isAdaptiveTailConverged(adaptive, discreteCF, cp)||numU>=maxNumU){
+                break;
+            }
+            numU=std::min(2*numU, maxNumU);
+        }
+        adaptive.report(numU);
+        return discreteCF;
     }
 
+    /**
+        Discrete CF used by every entry point which takes a CF.  numU is 
+        either a number of terms or AdaptiveNumU, and cf is a scalar CF or
+        a BatchCF.
+    */
     template<typename Number, typename CF, typename Index>
-    auto computeVaR(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
-        return computeVaRHelper(alpha, xMin, xMax, fangoost::computeDiscreteCFReal(xMin, xMax, numU, std::move(cf)), prec, prec);
+    auto computeDiscreteCFFixed(const Number& xMin, const Number& xMax, const Index& numU, const CF& cf){
+        return fangoost::computeDiscreteCFReal(xMin, xMax, numU, cf);
+    }
+    template<typename Number, typename Fn, typename Index>
+    auto computeDiscreteCFFixed(const Number& xMin, const Number& xMax, const Index& numU, const BatchCF<Fn>& cf){
+        std::vector<Number> discreteCF;
+        discreteCF.reserve(numU);
+        appendDiscreteCF(xMin, xMax, numU, cf, discreteCF);
+        return discreteCF;
     }
-    /**Newton is faster but not as stable*/
     template<typename Number, typename CF, typename Index>
-    auto computeVaRNewton(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, const Index& numU, CF&& cf){
-        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, fangoost::computeDiscreteCFReal(xMin, xMax, numU, std::move(cf)), prec1, prec2);
+    auto computeDiscreteCF(const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        return computeDiscreteCFFixed(xMin, xMax, numU, cf);
+    }
+    template<typename Number, typename CF>
+    auto computeDiscreteCF(const Number& xMin, const Number& xMax, const AdaptiveNumU& numU, CF&& cf){
+        return computeDiscreteCFAdaptive(xMin, xMax, numU, cf);
+    }
+    /**
+        computeDiscreteCF recording its time and size in stats.  The CF is 
+        evaluated once per coefficient.
+    */
+    template<typename Number, typename CF, typename Index, typename Stats>
+    auto computeDiscreteCFWithStats(const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, Stats& stats){
+        const auto start=stats.startStage();
+        auto discreteCF=computeDiscreteCF(xMin, xMax, numU, cf);
+        stats.endDiscreteCF(start, discreteCF.size());
+        return discreteCF;
+    }
+
+    /**
+        Number of points on the circle used by computeCumulants
+    */
+    constexpr int numCumulantPoints=32;
+
+    /**
+        Computes the first four cumulants of the distribution from the CF. 
+        As with every CF in this library, cf takes the complex argument z=iu,
+        so log(cf(z)) is the cumulant generating function and the cumulants 
+        are its Taylor coefficients at z=0.  These are computed by complex 
+        step differentiation on a circle of radius r around 0:
+        c_n=n!/r^n*mean_m log(cf(r w^m))w^(-mn), with w=exp(2 pi i/numCumulantPoints).
+        The error decays like r^numCumulantPoints rather than with a power of
+        the step.  r is chosen so that |log(cf)|<=1 on the circle, which keeps
+        the logarithm on its principal branch.  This requires that the MGF 
+        exists near zero.
+    */
+    template<typename CF>
+    auto computeCumulants(CF&& cf){
+        std::array<std::complex<double>, numCumulantPoints> logCF;
+        const auto evaluateCircle=[&](const double& radius){
+            double maxLogCF=0.0;
+            for(int m=0; m<numCumulantPoints; ++m){
+                const std::complex<double> z=std::polar(radius, 2.0*M_PI*m/numCumulantPoints);
+                logCF[m]=log(std::complex<double>(cf(z)));
+                const double size=std::abs(logCF[m]);
+                maxLogCF=std::isfinite(size)?std::max(maxLogCF, size):INFINITY;
+            }
+            return maxLogCF;
+        };
+        double radius=1.0;
+        bool hasShrunk=false;
+        for(int i=0; i<200; ++i){
+            const double maxLogCF=evaluateCircle(radius);
+            if(maxLogCF>1.0){
+                radius*=.5;
+                hasShrunk=true;
+            }
+            else if(maxLogCF<.25&&!hasShrunk){
+                radius*=2.0;
+            }
+            else{
+                break;
+            }
+        }
+        std::array<double, 4> cumulants;
+        double factorial=1.0;
+        for(int n=1; n<=4; ++n){
+            factorial*=n;
+            std::complex<double> coefficient(0.0, 0.0);
+            for(int m=0; m<numCumulantPoints; ++m){
+                coefficient+=logCF[m]*std::polar(1.0, -2.0*M_PI*m*n/numCumulantPoints);
+            }
+            cumulants[n-1]=factorial*coefficient.real()/(numCumulantPoints*pow(radius, n));
+        }
+        return cumulants;
+    }
+
+    /**
+        Truncation domain [c1-L*sqrt(c2+sqrt(|c4|)), c1+L*sqrt(c2+sqrt(|c4|))] 
+        of Fang and Oosterlee from the cumulants c_n.  Pass autoDomain (or 
+        AutoDomain(L)) in place of xMin and xMax to computeVaR, computeES and 
+        computeEL to use it.
+    */
+    struct AutoDomain{
+        double L;
+        constexpr explicit AutoDomain(double L_=10.0):L(L_){}
+    };
+    constexpr AutoDomain autoDomain{};
+
+    /**
+        returns pair of xMin and xMax
+    */
+    inline auto computeCumulantDomain(const AutoDomain& domain, const std::array<double, 4>& cumulants){
+        const double width=domain.L*sqrt(std::max(cumulants[1], 0.0)+sqrt(std::abs(cumulants[3])));
+        return std::make_pair(cumulants[0]-width, cumulants[0]+width);
+    }
+    template<typename CF>
+    auto computeDomain(const AutoDomain& domain, CF&& cf){
+        return computeCumulantDomain(domain, computeCumulants(cf));
+    }
+    /**
+        computeCumulants, with the CF evaluations counted towards the 
+        domain stage
+    */
+    template<typename CF, typename Stats>
+    auto computeCumulantsWithStats(const CF& cf, Stats& stats){
+        const auto start=stats.startStage();
+        std::size_t numCFEvaluations=0;
+        const auto cumulants=computeCumulants([&](const auto& z){
+            ++numCFEvaluations;
+            return cf(z);
+        });
+        stats.endDomain(start, numCFEvaluations);
+        return cumulants;
     }
+    template<typename CF, typename Stats>
+    auto computeDomainWithStats(const AutoDomain& domain, CF&& cf, Stats& stats){
+        return computeCumulantDomain(domain, computeCumulantsWithStats(cf, stats));
+    }
+
+    /**
+        Root of CDF(x)=alpha together with the CDF, density and partial 
+        expectation at the root
+    */
+    template<typename Number>
+    struct CDFRoot{
+        Number x;
+        PointEvaluation<Number> evaluation;
+    };
 
+    /**
+        Bisects over [lower, upper] until |CDF(x)-alpha|<prec1 or the half 
+        width of the bracket is below prec2.  Every step evaluates all of 
+        PointEvaluation in the same pass, so the partial expectation at the 
+        root is available without another pass over the coefficients.
+    */
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto bisectCDF(const Number& alpha, const Number& xMin, const Number& xMax, Number lower, Number upper, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, Stats& stats){
+        const auto start=stats.startStage();
+        Number x=.5*(lower+upper);
+        auto evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+        stats.addIteration();
+        while(std::abs(evaluation.cdf-alpha)>prec1&&.5*(upper-lower)>prec2){
+            if(evaluation.cdf<alpha){
+                lower=x;
+            }
+            else{
+                upper=x;
+            }
+            x=.5*(lower+upper);
+            evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+            stats.addIteration();
+        }
+        stats.endSolver(start, upper-lower);
+        return CDFRoot<Number>{x, evaluation};
+    }
     template<typename Number, typename CFDiscrete>
-    auto computeVaRNewtonDiscrete(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& cf){
-        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, std::move(cf), prec1, prec2);
+    auto bisectCDF(const Number& alpha, const Number& xMin, const Number& xMax, const Number& lower, const Number& upper, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2){
+        NoStats stats;
+        return bisectCDF(alpha, xMin, xMax, lower, upper, discreteCF, prec1, prec2, stats);
+    }
+
+    /**
+        Bracketing methods for CDF(x)=alpha.  All keep the root bracketed 
+        and stop on the same tests as bisectCDF.  brent is Brent's method 
+        (inverse quadratic and secant steps, falling back to bisection) and
+        itp is the Interpolate-Truncate-Project method of Oliveira and 
+        Takahashi, which never needs more than one more iteration than 
+        bisection.  Both usually converge superlinearly on the smooth COS 
+        CDF.
+    */
+    enum class RootMethod{
+        bisection,
+        brent,
+        itp
+    };
+    /**
+        With cumulantBracket the solver starts from a small bracket around 
+        the Cornish-Fisher estimate of the quantile rather than from the 
+        whole domain.  The functions taking a CF compute the cumulants 
+        themselves; the Discrete functions need them through withCumulants
+        and otherwise use the whole domain.
+    */
+    struct SolverOptions{
+        RootMethod method;
+        bool cumulantBracket;
+        bool hasCumulants;
+        std::array<double, 4> cumulants;
+        constexpr explicit SolverOptions(RootMethod method_=RootMethod::bisection, bool cumulantBracket_=false):
+            method(method_), cumulantBracket(cumulantBracket_), hasCumulants(false), cumulants{{0.0, 0.0, 0.0, 0.0}}{}
+        SolverOptions withCumulants(const std::array<double, 4>& cumulants_) const{
+            SolverOptions options=*this;
+            options.cumulantBracket=true;
+            options.hasCumulants=true;
+            options.cumulants=cumulants_;
+            return options;
+        }
+    };
+
+    /**
+        Quantile of the standard normal by Abramowitz and Stegun 26.2.23.  
+        The error is below 4.5e-4, which is plenty for a starting point.
+    */
+    inline double computeNormalQuantile(const double& p){
+        const double tail=std::min(p, 1.0-p);
+        const double t=sqrt(-2.0*log(tail));
+        const double upperQuantile=t-(2.515517+t*(.802853+t*.010328))/(1.0+t*(1.432788+t*(.189269+t*.001308)));
+        return p<.5?-upperQuantile:upperQuantile;
+    }
+
+    /**
+        Cornish-Fisher estimate of the alpha quantile from the first four 
+        cumulants, correcting the normal quantile for skew and kurtosis
+    */
+    inline double computeCornishFisherQuantile(const double& alpha, const std::array<double, 4>& cumulants){
+        if(!(cumulants[1]>0.0)||!(alpha>0.0&&alpha<1.0)){
+            return cumulants[0];
+        }
+        const double sd=sqrt(cumulants[1]);
+        const double skew=cumulants[2]/(cumulants[1]*sd);
+        const double kurtosis=cumulants[3]/(cumulants[1]*cumulants[1]);
+        const double z=computeNormalQuantile(alpha);
+        const double w=z+(z*z-1.0)*skew/6.0+(z*z*z-3.0*z)*kurtosis/24.0-(2.0*z*z*z-5.0*z)*skew*skew/36.0;
+        return cumulants[0]+sd*w;
+    }
+
+    /**
+        Half width, in standard deviations, of the first bracket around the
+        Cornish-Fisher estimate.  It doubles until it brackets the root.
+    */
+    constexpr double cumulantBracketWidth=.05;
+
+    /**
+        Brent's method on CDF(x)-alpha over [lower, upper].  b is the best 
+        estimate, a the previous one and c the other end of the bracket.
+    */
+    template<typename Number, typename Evaluation, typename CFDiscrete, typename Stats>
+    auto brentCDF(const Number& alpha, const Number& xMin, const Number& xMax, const Number& lower, const Number& upper, const Evaluation& lowerEvaluation, const Evaluation& upperEvaluation, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, Stats& stats){
+        const auto start=stats.startStage();
+        Number a=lower;
+        Number b=upper;
+        auto evaluationA=lowerEvaluation;
+        auto evaluationB=upperEvaluation;
+        Number fa=evaluationA.cdf-alpha;
+        Number fb=evaluationB.cdf-alpha;
+        Number c=a;
+        Number fc=fa;
+        auto evaluationC=evaluationA;
+        Number d=b-a;
+        Number e=d;
+        while(true){
+            if((fb>0&&fc>0)||(fb<0&&fc<0)){
+                c=a;
+                fc=fa;
+                evaluationC=evaluationA;
+                d=b-a;
+                e=d;
+            }
+            if(std::abs(fc)<std::abs(fb)){
+                a=b;
+                fa=fb;
+                evaluationA=evaluationB;
+                b=c;
+                fb=fc;
+                evaluationB=evaluationC;
+                c=a;
+                fc=fa;
+                evaluationC=evaluationA;
+            }
+            const Number m=.5*(c-b);
+            if(std::abs(fb)<=prec1||std::abs(m)<=prec2){
+                stats.endSolver(start, std::abs(c-b));
+                return CDFRoot<Number>{b, evaluationB};
+            }
+            if(std::abs(e)>=prec2&&std::abs(fa)>std::abs(fb)){
+                const Number ratioBA=fb/fa;
+                Number p, q;
+                if(a==c){
+                    p=2.0*m*ratioBA;
+                    q=1.0-ratioBA;
+                }
+                else{
+                    const Number ratioAC=fa/fc;
+                    const Number ratioBC=fb/fc;
+                    p=ratioBA*(2.0*m*ratioAC*(ratioAC-ratioBC)-(b-a)*(ratioBC-1.0));
+                    q=(ratioAC-1.0)*(ratioBC-1.0)*(ratioBA-1.0);
+                }
+                if(p>0){
+                    q=-q;
+                }
+                else{
+                    p=-p;
+                }
+                if(2.0*p<std::min(3.0*m*q-std::abs(prec2*q), std::abs(e*q))){
+                    e=d;
+                    d=p/q;
+                }
+                else{
+                    d=m;
+                    e=m;
+                }
+            }
+            else{
+                d=m;
+                e=m;
+            }
+            a=b;
+            fa=fb;
+            evaluationA=evaluationB;
+            b+=std::abs(d)>prec2?d:(m>0?prec2:-prec2);
+            evaluationB=evaluatePoint(b, xMin, xMax, discreteCF);
+            fb=evaluationB.cdf-alpha;
+            stats.addIteration();
+        }
+    }
+
+    /**
+        ITP on CDF(x)-alpha over [lower, upper] with kappa1=.2/(upper-lower),
+        kappa2=2 and n0=1
+    */
+    template<typename Number, typename Evaluation, typename CFDiscrete, typename Stats>
+    auto itpCDF(const Number& alpha, const Number& xMin, const Number& xMax, Number lower, Number upper, const Evaluation& lowerEvaluation, const Evaluation& upperEvaluation, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, Stats& stats){
+        const auto start=stats.startStage();
+        Number fLower=lowerEvaluation.cdf-alpha;
+        Number fUpper=upperEvaluation.cdf-alpha;
+        const Number kappa1=.2/(upper-lower);
+        const int maxHalvings=static_cast<int>(std::ceil(std::log2(std::max((upper-lower)/(2.0*prec2), 1.0))))+1;
+        Number x=upper;
+        auto evaluation=upperEvaluation;
+        for(int j=0; j<=maxHalvings; ++j){
+            const Number halfWidth=.5*(upper-lower);
+            const Number midpoint=lower+halfWidth;
+            const Number radius=prec2*std::pow(2.0, maxHalvings-j)-halfWidth;
+            const Number delta=kappa1*(upper-lower)*(upper-lower);
+            const Number falsePosition=(fUpper*lower-fLower*upper)/(fUpper-fLower);
+            const Number sigma=midpoint>=falsePosition?1.0:-1.0;
+            const Number truncated=delta<=std::abs(midpoint-falsePosition)?falsePosition+sigma*delta:midpoint;
+            x=std::abs(truncated-midpoint)<=radius?truncated:midpoint-sigma*radius;
+            evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+            stats.addIteration();
+            const Number fx=evaluation.cdf-alpha;
+            if(fx>0){
+                upper=x;
+                fUpper=fx;
+            }
+            else{
+                lower=x;
+                fLower=fx;
+            }
+            if(std::abs(fx)<=prec1||.5*(upper-lower)<=prec2){
+                break;
+            }
+        }
+        stats.endSolver(start, upper-lower);
+        return CDFRoot<Number>{x, evaluation};
+    }
+
+    /**
+        Root of CDF(x)=alpha in [lower, upper] by options.method, starting 
+        from the Cornish-Fisher bracket if options has cumulants.  The 
+        interpolating methods need CDF(lower)<alpha<CDF(upper); if that does
+        not hold, bisection is used.
+    */
+    template<typename Number, typename Evaluation, typename CFDiscrete, typename Stats>
+    auto solveCDFInBracket(const Number& alpha, const Number& xMin, const Number& xMax, const Number& lower, const Number& upper, const Evaluation& lowerEvaluation, const Evaluation& upperEvaluation, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, const RootMethod& method, Stats& stats){
+        if(method!=RootMethod::bisection&&lowerEvaluation.cdf<alpha&&upperEvaluation.cdf>alpha){
+            return method==RootMethod::brent?
+                brentCDF(alpha, xMin, xMax, lower, upper, lowerEvaluation, upperEvaluation, discreteCF, prec1, prec2, stats):
+                itpCDF(alpha, xMin, xMax, lower, upper, lowerEvaluation, upperEvaluation, discreteCF, prec1, prec2, stats);
+        }
+        return bisectCDF(alpha, xMin, xMax, lower, upper, discreteCF, prec1, prec2, stats);
+    }
+    /**
+        Starts from [guess-width, guess+width] within [lower, upper] and 
+        steps the bracket outwards, doubling the step, until CDF(lower)<=alpha
+        <=CDF(upper).  The evaluations at the ends of the bracket count as 
+        iterations.
+    */
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto solveCDFFromGuess(const Number& alpha, const Number& xMin, const Number& xMax, Number lower, Number upper, const Number& guess, const Number& width, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, const RootMethod& method, Stats& stats){
+        const Number minimum=lower;
+        const Number maximum=upper;
+        const Number center=std::min(std::max(guess, minimum), maximum);
+        Number step=std::max(width, 2.0*prec2);
+        lower=std::max(minimum, center-step);
+        upper=std::min(maximum, center+step);
+        auto lowerEvaluation=evaluatePoint(lower, xMin, xMax, discreteCF);
+        auto upperEvaluation=evaluatePoint(upper, xMin, xMax, discreteCF);
+        stats.addIteration();
+        stats.addIteration();
+        while(lowerEvaluation.cdf>alpha&&lower>minimum){
+            upper=lower;
+            upperEvaluation=lowerEvaluation;
+            step*=2.0;
+            lower=std::max(minimum, lower-step);
+            lowerEvaluation=evaluatePoint(lower, xMin, xMax, discreteCF);
+            stats.addIteration();
+        }
+        while(upperEvaluation.cdf<alpha&&upper<maximum){
+            lower=upper;
+            lowerEvaluation=upperEvaluation;
+            step*=2.0;
+            upper=std::min(maximum, upper+step);
+            upperEvaluation=evaluatePoint(upper, xMin, xMax, discreteCF);
+            stats.addIteration();
+        }
+        return solveCDFInBracket(alpha, xMin, xMax, lower, upper, lowerEvaluation, upperEvaluation, discreteCF, prec1, prec2, method, stats);
+    }
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto solveCDF(const Number& alpha, const Number& xMin, const Number& xMax, const Number& lower, const Number& upper, const CFDiscrete& discreteCF, const Number& prec1, const Number& prec2, const SolverOptions& options, Stats& stats){
+        if(options.cumulantBracket&&options.hasCumulants){
+            const Number width=cumulantBracketWidth*sqrt(std::max(options.cumulants[1], 0.0));
+            return solveCDFFromGuess(alpha, xMin, xMax, lower, upper, computeCornishFisherQuantile(alpha, options.cumulants), width, discreteCF, prec1, prec2, options.method, stats);
+        }
+        if(options.method!=RootMethod::bisection){
+            //the interpolating methods start from the CDF at both ends
+            const auto lowerEvaluation=evaluatePoint(lower, xMin, xMax, discreteCF);
+            const auto upperEvaluation=evaluatePoint(upper, xMin, xMax, discreteCF);
+            stats.addIteration();
+            stats.addIteration();
+            return solveCDFInBracket(alpha, xMin, xMax, lower, upper, lowerEvaluation, upperEvaluation, discreteCF, prec1, prec2, options.method, stats);
+        }
+        return bisectCDF(alpha, xMin, xMax, lower, upper, discreteCF, prec1, prec2, stats);
+    }
+    /**
+        Fills in the cumulants of cf when options asks for the cumulant 
+        bracket without them.  The CF evaluations count towards the domain
+        stage.
+    */
+    template<typename CF, typename Stats>
+    SolverOptions addCumulants(const SolverOptions& options, const CF& cf, Stats& stats){
+        if(!options.cumulantBracket||options.hasCumulants){
+            return options;
+        }
+        return options.withCumulants(computeCumulantsWithStats(cf, stats));
+    }
+    /**
+        A BatchCF only evaluates on the imaginary axis, so it cannot give 
+        the cumulants: the cumulant bracket then needs them passed in with
+        SolverOptions::withCumulants
+    */
+    template<typename Fn, typename Stats>
+    SolverOptions addCumulants(const SolverOptions& options, const BatchCF<Fn>&, Stats&){
+        if(options.cumulantBracket&&!options.hasCumulants){
+            throw std::invalid_argument("the cumulant bracket needs a scalar CF or SolverOptions::withCumulants for a BatchCF");
+        }
+        return options;
     }
 
+    //this is a helper function.  It bisects over [lower, upper] until it finds the point such that the CDF is equal to alpha 
     template<typename Number, typename CFDiscrete>
-    auto computeVaRDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf){
-        return computeVaRHelper(alpha, xMin, xMax, std::move(cf), prec, prec);
+    auto computeVaRBracketHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& lower, const Number& upper, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2){
+        return -bisectCDF(alpha, xMin, xMax, lower, upper, discreteCF, prec1, prec2).x;
+    }
+    //this is a helper function.  It bisects until it finds the point such that the CDF is equal to alpha 
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRHelper(const Number& alpha, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2){
+        return computeVaRBracketHelper(alpha, xMin, xMax, xMin, xMax, discreteCF, prec1, prec2);
+    }
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computeVaRHelper(const Number& alpha, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2, const SolverOptions& options, Stats& stats){
+        return -solveCDF(alpha, xMin, xMax, xMin, xMax, discreteCF, prec1, prec2, options, stats).x;
     }
 
-    constexpr int ES=0;
-    constexpr int VAR=1;
     /**
-     * returns tuple of ES and VaR
-     */
-    template<typename Number,typename CFDiscrete>
-    auto computeESDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf){
-        const auto VaR=computeVaRDiscrete(alpha, prec,
-            xMin, xMax, 
-            cf
+        Complex product without the inf/nan handling of std::complex's 
+        operator*, which otherwise goes through a library call
+    */
+    inline std::complex<double> multiplyComplex(const std::complex<double>& left, const std::complex<double>& right){
+        return std::complex<double>(
+            left.real()*right.real()-left.imag()*right.imag(), 
+            left.real()*right.imag()+left.imag()*right.real()
         );
-        return std::make_tuple(
-            -fangoost::computeExpectationPointDiscrete(
-            -VaR,
-            xMin, 
-            xMax,
-            std::move(cf), 
-            [&](const auto& u, const auto& x, const auto& index){
-                return VkE(u, x, xMin, xMax, index);
+    }
+    /**
+        Writes exp(sign*2 pi i k/n) for k=0..count-1 to roots, by the same 
+        re-seeded rotation recurrence as computePointSums
+    */
+    inline void computeUnitRoots(std::size_t n, std::size_t count, int sign, std::vector<std::complex<double> >& roots){
+        roots.resize(count);
+        const auto step=std::polar(1.0, sign*2.0*M_PI/n);
+        for(std::size_t k=0; k<count; ++k){
+            roots[k]=k%reseedInterval==0?std::polar(1.0, sign*2.0*M_PI*k/n):multiplyComplex(roots[k-1], step);
+        }
+    }
+    /**
+        Smallest transform whose butterfly stages and pointwise products are
+        split across threads; below it the fork and join costs more than 
+        the work
+    */
+    constexpr std::size_t minParallelTransformSize=4096;
+    /**
+        In place radix-2 FFT of data, whose size must be a power of two.  
+        sign=1 computes sum_m data_m exp(2 pi i mj/n), sign=-1 the forward
+        transform.  Neither is normalized.  twiddles is scratch storage.  
+        The butterflies of each stage are independent, so they are split 
+        over numThreads with results identical to the serial transform.
+    */
+    inline void computeFFTRadix2(std::vector<std::complex<double> >& data, int sign, std::vector<std::complex<double> >& twiddles, int numThreads=1){
+        const std::size_t n=data.size();
+        for(std::size_t i=1, j=0; i<n; ++i){
+            std::size_t bit=n>>1;
+            for(; j&bit; bit>>=1){
+                j^=bit;
+            }
+            j^=bit;
+            if(i<j){
+                std::swap(data[i], data[j]);
             }
-        )/alpha, VaR);
+        }
+        computeUnitRoots(n, n/2, sign, twiddles);
+        const long numButterflies=static_cast<long>(n/2);
+        #pragma omp parallel num_threads(numThreads) if(numThreads>1&&n>=minParallelTransformSize)
+        for(std::size_t length=2; length<=n; length<<=1){
+            const std::size_t half=length/2;
+            const std::size_t stride=n/length;
+            #pragma omp for schedule(static)
+            for(long butterfly=0; butterfly<numButterflies; ++butterfly){
+                const std::size_t k=butterfly%half;
+                const std::size_t index=(butterfly/half)*length+k;
+                const auto even=data[index];
+                const auto odd=multiplyComplex(data[index+half], twiddles[k*stride]);
+                data[index]=even+odd;
+                data[index+half]=even-odd;
+            }
+        }
+    }
+    inline std::size_t nextPowerOfTwo(std::size_t n){
+        std::size_t result=1;
+        while(result<n){
+            result<<=1;
+        }
+        return result;
     }
     /**
-     * returns tuple of ES and VaR
-     */
-    template<typename Number, typename CF, typename Index>
-    auto computeES(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
-        return computeESDiscrete(alpha, prec, xMin, xMax, 
-            fangoost::computeDiscreteCFReal(xMin, xMax, numU, std::move(cf))
-        );
+        Storage for computeDFT.  The vectors keep their capacity between 
+        calls, so a reused TransformWorkspace does not allocate.
+    */
+    struct TransformWorkspace{
+        std::vector<std::complex<double> > data;
+        std::vector<std::complex<double> > twiddles;
+        std::vector<std::complex<double> > roots;
+        std::vector<std::complex<double> > chirp;
+        std::vector<std::complex<double> > convolution;
+        std::vector<std::complex<double> > chirpTransform;
+    };
+    /**
+        In place DFT of workspace.data of any length; see computeFFTRadix2 
+        for sign.  Lengths which are not powers of two use Bluestein's 
+        algorithm, which writes the DFT as a convolution evaluated with power
+        of two FFTs.
+    */
+    inline void computeDFT(TransformWorkspace& workspace, int sign, int numThreads=1){
+        auto& data=workspace.data;
+        const std::size_t n=data.size();
+        if(n<=1||nextPowerOfTwo(n)==n){
+            computeFFTRadix2(data, sign, workspace.twiddles, numThreads);
+            return;
+        }
+        const std::size_t m=nextPowerOfTwo(2*n-1);
+        //chirp exp(sign*i*pi*k^2/n), a root of unity of order 2n indexed by k^2 mod 2n
+        computeUnitRoots(2*n, 2*n, sign, workspace.roots);
+        auto& chirp=workspace.chirp;
+        chirp.resize(n);
+        for(std::size_t k=0; k<n; ++k){
+            chirp[k]=workspace.roots[(static_cast<unsigned long long>(k)*k)%(2*n)];
+        }
+        auto& a=workspace.convolution;
+        auto& b=workspace.chirpTransform;
+        a.assign(m, 0.0);
+        b.assign(m, 0.0);
+        for(std::size_t k=0; k<n; ++k){
+            a[k]=multiplyComplex(data[k], chirp[k]);
+        }
+        b[0]=std::conj(chirp[0]);
+        for(std::size_t k=1; k<n; ++k){
+            b[k]=std::conj(chirp[k]);
+            b[m-k]=std::conj(chirp[k]);
+        }
+        computeFFTRadix2(a, -1, workspace.twiddles, numThreads);
+        computeFFTRadix2(b, -1, workspace.twiddles, numThreads);
+        const long numProducts=static_cast<long>(m);
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1&&m>=minParallelTransformSize)
+        for(long k=0; k<numProducts; ++k){
+            a[k]=multiplyComplex(a[k], b[k]);
+        }
+        computeFFTRadix2(a, 1, workspace.twiddles, numThreads);
+        const long numOutputs=static_cast<long>(n);
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1&&m>=minParallelTransformSize)
+        for(long k=0; k<numOutputs; ++k){
+            data[k]=multiplyComplex(a[k], chirp[k])/static_cast<double>(m);
+        }
     }
-    
-    template<typename Number, typename CF, typename Index>
-    auto computeEL(const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
-        return fangoost::computeExpectationPoint(xMax, xMin, xMax, numU, std::move(cf), [&](const auto& u, const auto& x, const auto& index){
-            return VkE(u, x, xMin, xMax, index);
-        });
+
+    /**
+        The sums of PointSums needed by the CDF and the partial expectation, 
+        at every point of a uniform x grid
+    */
+    struct GridSums{
+        std::vector<double> sinOverU;
+        std::vector<double> cosMinusOneOverUSquared;
+    };
+
+    /**
+        Computes GridSums on the grid x_j=xMin+j*dx, j=0..numX-1, with a 
+        transform.  On this grid (x_j-a)u_k=pi*jk/(numX-1), so both sums are
+        a DFT of length 2(numX-1) of the coefficients folded modulo 
+        2(numX-1): the sin coefficients fold antisymmetrically (their DFT is
+        imaginary) and the cos coefficients symmetrically (their DFT is real),
+        so one transform of the sum of the two gives both.  Cost is 
+        O(numU+numX log numX).  The folding is serial; the transform is 
+        split over numThreads.
+    */
+    inline void computeGridSumsTransform(std::size_t numX, double xMin, double xMax, const DiscreteCFView<double>& discreteCF, GridSums& sums, TransformWorkspace& workspace, int numThreads=1){
+        const std::size_t period=2*(numX-1);
+        const double du=fangoost::computeDU(xMin, xMax);
+        auto& folded=workspace.data;
+        folded.assign(period, 0.0);
+        double cosOverUSquaredTotal=0.0;
+        for(std::size_t k=1; k<discreteCF.size(); ++k){
+            const double uDen=1.0/(k*du);
+            const double sinCoefficient=discreteCF[k]*uDen;
+            const double cosCoefficient=sinCoefficient*uDen;
+            const std::size_t m=k%period;
+            folded[m]+=.5*(cosCoefficient+sinCoefficient);
+            folded[(period-m)%period]+=.5*(cosCoefficient-sinCoefficient);
+            cosOverUSquaredTotal+=cosCoefficient;
+        }
+        computeDFT(workspace, 1, numThreads);
+        sums.sinOverU.resize(numX);
+        sums.cosMinusOneOverUSquared.resize(numX);
+        for(std::size_t j=0; j<numX; ++j){
+            sums.sinOverU[j]=folded[j].imag();
+            sums.cosMinusOneOverUSquared[j]=folded[j].real()-cosOverUSquaredTotal;
+        }
     }
-    template<typename Number, typename CFDiscrete>
-    auto computeELDiscrete(const Number& xMin, const Number& xMax, CFDiscrete&& cf){
-        return fangoost::computeExpectationPointDiscrete(xMax, xMin, xMax, std::move(cf), [&](const auto& u, const auto& x, const auto& index){
-            return VkE(u, x, xMin, xMax, index);
-        });
+
+    /**
+        Cost of a transform step relative to one term of the point kernel.  
+        The gridSums(point) and gridSums(transform) results of make bench 
+        cross between numU=64 and 128 at numX=1024, below the numU of about 
+        290 this ratio gives, so it errs towards the point kernel
+    */
+    constexpr double transformCostRatio=2.0;
+    constexpr std::size_t minTransformNumX=16;
+    /**
+        Chooses computeGridSumsTransform when its cost, about one (power of
+        two length) or three (Bluestein) FFTs of length m at m log2(m) each, 
+        is below the numX*numU cost of evaluating point by point.
+    */
+    inline bool useGridTransform(std::size_t numX, std::size_t numU){
+        if(numX<minTransformNumX){
+            return false;
+        }
+        const std::size_t period=2*(numX-1);
+        const bool isPowerOfTwo=nextPowerOfTwo(period)==period;
+        const std::size_t m=isPowerOfTwo?period:nextPowerOfTwo(2*period-1);
+        const double numFFT=isPowerOfTwo?1.0:3.0;
+        return static_cast<double>(numX)*numU>transformCostRatio*numFFT*m*std::log2(static_cast<double>(m));
+    }
+
+    /**
+        Execution policy for the grid functions.  The grid is split across 
+        numThreads OpenMP threads; numThreads=0 uses the OpenMP default.  
+        Every point is evaluated exactly as in the serial path, so results
+        are bit-identical to it.  On large grids, where the transform path 
+        is used, the butterfly stages of the FFTs are split instead.
+    */
+    struct ParallelPolicy{
+        int numThreads;
+    };
+    constexpr ParallelPolicy par{0};
+    constexpr ParallelPolicy seq{1};
+    inline int getNumThreads(const ParallelPolicy& policy){
+        #ifdef _OPENMP
+            return policy.numThreads>0?policy.numThreads:omp_get_max_threads();
+        #else
+            return 1;
+        #endif
+    }
+
+    /**
+        GridSums on the uniform grid from xMin to xMax for contiguous double 
+        coefficients; by transform when the grid is large and point by point
+        otherwise.  Both are split over numThreads.
+    */
+    inline void computeGridSums(std::size_t numX, double xMin, double xMax, const DiscreteCFView<double>& discreteCF, GridSums& sums, TransformWorkspace& workspace, int numThreads=1){
+        if(useGridTransform(numX, discreteCF.size())){
+            computeGridSumsTransform(numX, xMin, xMax, discreteCF, sums, workspace, numThreads);
+            return;
+        }
+        sums.sinOverU.resize(numX);
+        sums.cosMinusOneOverUSquared.resize(numX);
+        const double dx=(xMax-xMin)/(numX-1);
+        const int numPoints=static_cast<int>(numX);
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1)
+        for(int j=0; j<numPoints; ++j){
+            const auto pointSums=computePointSums(xMin+j*dx, xMin, xMax, discreteCF);
+            sums.sinOverU[j]=pointSums.sinOverU;
+            sums.cosMinusOneOverUSquared[j]=pointSums.cosMinusOneOverUSquared;
+        }
     }
 
+    /**
+        Write the CDF and the partial expectation on the grid from GridSums
+        to out, returning the end of the output
+    */
+    template<typename OutputIterator>
+    OutputIterator writeCDFGrid(std::size_t numX, double xMin, double xMax, const DiscreteCFView<double>& discreteCF, const GridSums& sums, OutputIterator out){
+        const double halfFirst=discreteCF.size()>0?.5*discreteCF[0]:0.0;
+        const double dx=(xMax-xMin)/(numX-1);
+        for(std::size_t j=0; j<numX; ++j, ++out){
+            *out=halfFirst*j*dx+sums.sinOverU[j];
+        }
+        return out;
+    }
+    template<typename OutputIterator>
+    OutputIterator writePartialExpectationGrid(std::size_t numX, double xMin, double xMax, const DiscreteCFView<double>& discreteCF, const GridSums& sums, OutputIterator out){
+        const double halfFirst=discreteCF.size()>0?.5*discreteCF[0]:0.0;
+        const double dx=(xMax-xMin)/(numX-1);
+        for(std::size_t j=0; j<numX; ++j, ++out){
+            const double x=xMin+j*dx;
+            *out=halfFirst*diffPow(x, xMin)+x*sums.sinOverU[j]+sums.cosMinusOneOverUSquared[j];
+        }
+        return out;
+    }
+
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computeCDFGrid(const Index& numXDiscrete, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF, int numThreads=1){
+        return fangoost::computeExpectationDiscrete(numXDiscrete, xMin, xMax, discreteCF, [&](const auto& u, const auto& x, const auto& index){
+            return VkCDF(u, x, xMin, xMax, index);
+        });
+    }
+    template<typename Index>
+    auto computeCDFGrid(const Index& numXDiscrete, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF, int numThreads=1){
+        const std::size_t numX=numXDiscrete;
+        GridSums sums;
+        TransformWorkspace workspace;
+        computeGridSums(numX, xMin, xMax, discreteCF, sums, workspace, numThreads);
+        std::vector<double> cdf(numX);
+        writeCDFGrid(numX, xMin, xMax, discreteCF, sums, cdf.begin());
+        return cdf;
+    }
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computePartialExpectationGrid(const Index& numXDiscrete, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF, int numThreads=1){
+        return fangoost::computeExpectationDiscrete(numXDiscrete, xMin, xMax, discreteCF, [&](const auto& u, const auto& x, const auto& index){
+            return VkE(u, x, xMin, xMax, index);
+        });
+    }
+    template<typename Index>
+    auto computePartialExpectationGrid(const Index& numXDiscrete, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF, int numThreads=1){
+        const std::size_t numX=numXDiscrete;
+        GridSums sums;
+        TransformWorkspace workspace;
+        computeGridSums(numX, xMin, xMax, discreteCF, sums, workspace, numThreads);
+        std::vector<double> expectation(numX);
+        writePartialExpectationGrid(numX, xMin, xMax, discreteCF, sums, expectation.begin());
+        return expectation;
+    }
+
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computeCDF(const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        return computeCDFGrid(numXDiscrete, xMin, xMax, viewOf(discreteCF));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDF(const Index& numXDiscrete, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computeCDF(numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    /**
+        Computes the partial expectation E[X 1_{X<x}] on a uniform grid of 
+        numXDiscrete points from xMin to xMax
+    */
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computePartialExpectation(const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        return computePartialExpectationGrid(numXDiscrete, xMin, xMax, viewOf(discreteCF));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectation(const Index& numXDiscrete, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computePartialExpectation(numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDF(const Index& numXDiscrete, const AdaptiveNumU& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computeCDF(numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectation(const Index& numXDiscrete, const AdaptiveNumU& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computePartialExpectation(numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    /**
+        Parallel versions of computeCDF and computePartialExpectation, e.g. 
+        computeCDF(par, numXDiscrete, xMin, xMax, discreteCF) or 
+        computeCDF(ParallelPolicy{4}, ...) for four threads
+    */
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computeCDF(const ParallelPolicy& policy, const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        return computeCDFGrid(numXDiscrete, xMin, xMax, viewOf(discreteCF), getNumThreads(policy));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDF(const ParallelPolicy& policy, const Index& numXDiscrete, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computeCDF(policy, numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computePartialExpectation(const ParallelPolicy& policy, const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        return computePartialExpectationGrid(numXDiscrete, xMin, xMax, viewOf(discreteCF), getNumThreads(policy));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectation(const ParallelPolicy& policy, const Index& numXDiscrete, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computePartialExpectation(policy, numXDiscrete, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    /**
+        The grid functions also take a trailing SolverStats; the time spent
+        on the grid is recorded as solver time
+    */
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computeCDF(const ParallelPolicy& policy, const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        const auto start=stats.startStage();
+        auto cdf=computeCDF(policy, numXDiscrete, xMin, xMax, discreteCF);
+        stats.endSolver(start, 0.0);
+        return cdf;
+    }
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computeCDF(const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computeCDF(seq, numXDiscrete, xMin, xMax, discreteCF, stats);
+    }
+    template<typename Number, typename CF, typename NumU, typename Index>
+    auto computeCDF(const ParallelPolicy& policy, const Index& numXDiscrete, const NumU& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computeCDF(policy, numXDiscrete, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename Number, typename CF, typename NumU, typename Index>
+    auto computeCDF(const Index& numXDiscrete, const NumU& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computeCDF(seq, numXDiscrete, numU, xMin, xMax, cf, stats);
+    }
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computePartialExpectation(const ParallelPolicy& policy, const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        const auto start=stats.startStage();
+        auto expectation=computePartialExpectation(policy, numXDiscrete, xMin, xMax, discreteCF);
+        stats.endSolver(start, 0.0);
+        return expectation;
+    }
+    template<typename Number, typename CFDiscrete, typename Index>
+    auto computePartialExpectation(const Index& numXDiscrete, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computePartialExpectation(seq, numXDiscrete, xMin, xMax, discreteCF, stats);
+    }
+    template<typename Number, typename CF, typename NumU, typename Index>
+    auto computePartialExpectation(const ParallelPolicy& policy, const Index& numXDiscrete, const NumU& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computePartialExpectation(policy, numXDiscrete, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename Number, typename CF, typename NumU, typename Index>
+    auto computePartialExpectation(const Index& numXDiscrete, const NumU& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computePartialExpectation(seq, numXDiscrete, numU, xMin, xMax, cf, stats);
+    }
+    /**
+        Reusable storage for serving computeCDF and computePartialExpectation:
+        the u grid with its phase factors cp*exp(-i u_k xMin), the 
+        coefficients, the grid sums, scratch for the transforms and the 
+        output.  The u grid is recomputed only when xMin or xMax change, and
+        extended when numU grows.  Once its buffers have grown to the sizes in use, calls with
+        a Workspace make no heap allocations.
+    */
+    struct Workspace{
+        double xMin;
+        double xMax;
+        std::vector<std::complex<double> > u;
+        std::vector<std::complex<double> > phase;
+        std::vector<double> discreteCF;
+        GridSums sums;
+        TransformWorkspace transform;
+        std::vector<double> output;
+        BatchScratch batch;
+        Workspace():xMin(0.0), xMax(0.0){}
+    };
+
+    /**
+        Makes sure workspace caches at least numTerms phases for xMin and 
+        xMax.  Since u_k=k*du does not depend on numU, the phases cached 
+        for a larger numU serve a smaller one.
+    */
+    inline void cachePhases(Workspace& workspace, const double& xMin, const double& xMax, std::size_t numTerms){
+        if(workspace.xMin!=xMin||workspace.xMax!=xMax){
+            workspace.u.clear();
+            workspace.phase.clear();
+            workspace.xMin=xMin;
+            workspace.xMax=xMax;
+        }
+        const double du=fangoost::computeDU(xMin, xMax);
+        const double cp=fangoost::computeCP(du);
+        for(std::size_t k=workspace.u.size(); k<numTerms; ++k){
+            workspace.u.emplace_back(0.0, k*du);
+            workspace.phase.push_back(cp*exp(-workspace.u[k]*xMin));
+        }
+    }
+    /**
+        Appends the terms workspace.discreteCF.size() to numTerms-1: a 
+        scalar CF uses the phases cached in workspace, and a BatchCF goes 
+        through appendDiscreteCF with the scratch buffers of workspace.
+    */
+    template<typename CF>
+    void appendDiscreteCF(Workspace& workspace, std::size_t numTerms, const CF& cf){
+        const std::size_t first=workspace.discreteCF.size();
+        workspace.discreteCF.resize(numTerms);
+        for(std::size_t k=first; k<numTerms; ++k){
+            workspace.discreteCF[k]=multiplyComplex(std::complex<double>(cf(workspace.u[k])), workspace.phase[k]).real();
+        }
+    }
+    template<typename Fn>
+    void appendDiscreteCF(Workspace& workspace, std::size_t numTerms, const BatchCF<Fn>& cf){
+        appendDiscreteCF(workspace.xMin, workspace.xMax, numTerms, cf, workspace.discreteCF, workspace.batch);
+    }
+
+    /**
+        Computes the discrete CF into workspace.discreteCF and returns a view 
+        of it.  With AdaptiveNumU the terms are kept as the grid grows, as 
+        in computeDiscreteCFAdaptive, and the size of the view is the numU
+        chosen.
+    */
+    template<typename CF, typename Index>
+    auto computeDiscreteCF(Workspace& workspace, const double& xMin, const double& xMax, const Index& numU, CF&& cf){
+        const std::size_t numTerms=numU;
+        cachePhases(workspace, xMin, xMax, numTerms);
+        workspace.discreteCF.clear();
+        appendDiscreteCF(workspace, numTerms, cf);
+        return DiscreteCFView<double>(workspace.discreteCF);
+    }
+    template<typename CF>
+    auto computeDiscreteCF(Workspace& workspace, const double& xMin, const double& xMax, const AdaptiveNumU& adaptive, CF&& cf){
+        const double cp=fangoost::computeCP(fangoost::computeDU(xMin, xMax));
+        const std::size_t maxNumU=std::max<std::size_t>(adaptive.maxNumU, 1);
+        std::size_t numU=std::min(std::max<std::size_t>(adaptive.initialNumU, 4), maxNumU);
+        workspace.discreteCF.clear();
+        while(true){
+            cachePhases(workspace, xMin, xMax, numU);
+            appendDiscreteCF(workspace, numU, cf);
+            if(isAdaptiveTailConverged(adaptive, workspace.discreteCF, cp)||numU>=maxNumU){
+                break;
+            }
+            numU=std::min(2*numU, maxNumU);
+        }
+        adaptive.report(numU);
+        return DiscreteCFView<double>(workspace.discreteCF);
+    }
+
+    /**
+        Writes the CDF on the uniform grid to out, using workspace for 
+        scratch, and returns the end of the output.  out may be any output 
+        iterator, e.g. a pointer into a caller owned buffer.
+    */
+    template<typename Index, typename OutputIterator>
+    auto computeCDF(Workspace& workspace, const Index& numXDiscrete, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF, OutputIterator out){
+        const std::size_t numX=numXDiscrete;
+        computeGridSums(numX, xMin, xMax, discreteCF, workspace.sums, workspace.transform);
+        return writeCDFGrid(numX, xMin, xMax, discreteCF, workspace.sums, out);
+    }
+    /**
+        returns workspace.output, which holds the CDF until the workspace is
+        next used
+    */
+    template<typename CF, typename NumU, typename Index>
+    const std::vector<double>& computeCDF(Workspace& workspace, const Index& numXDiscrete, const NumU& numU, const double& xMin, const double& xMax, CF&& cf){
+        const auto discreteCF=computeDiscreteCF(workspace, xMin, xMax, numU, cf);
+        workspace.output.resize(numXDiscrete);
+        computeCDF(workspace, numXDiscrete, xMin, xMax, discreteCF, workspace.output.begin());
+        return workspace.output;
+    }
+    template<typename Index, typename OutputIterator>
+    auto computePartialExpectation(Workspace& workspace, const Index& numXDiscrete, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF, OutputIterator out){
+        const std::size_t numX=numXDiscrete;
+        computeGridSums(numX, xMin, xMax, discreteCF, workspace.sums, workspace.transform);
+        return writePartialExpectationGrid(numX, xMin, xMax, discreteCF, workspace.sums, out);
+    }
+    template<typename CF, typename NumU, typename Index>
+    const std::vector<double>& computePartialExpectation(Workspace& workspace, const Index& numXDiscrete, const NumU& numU, const double& xMin, const double& xMax, CF&& cf){
+        const auto discreteCF=computeDiscreteCF(workspace, xMin, xMax, numU, cf);
+        workspace.output.resize(numXDiscrete);
+        computePartialExpectation(workspace, numXDiscrete, xMin, xMax, discreteCF, workspace.output.begin());
+        return workspace.output;
+    }
+
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoint(const Number& xValue, const Number& xMin, const Number&xMax, CFDiscrete&& cfDiscrete){
+        return evaluatePoint(xValue, xMin, xMax, cfDiscrete).cdf;
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoint(const Number& xValue,const Index& numU, const Number& xMin, const Number&xMax, CF&& cf){
+        return computeCDFAtPoint(xValue, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoint(const Number& xValue, const Number& xMin, const Number&xMax, CFDiscrete&& cfDiscrete, SolverStats& stats){
+        const auto start=stats.startStage();
+        const auto cdf=computeCDFAtPoint(xValue, xMin, xMax, cfDiscrete);
+        stats.endSolver(start, 0.0);
+        return cdf;
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoint(const Number& xValue,const Index& numU, const Number& xMin, const Number&xMax, CF&& cf, SolverStats& stats){
+        return computeCDFAtPoint(xValue, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+
+    /**
+        GridSums at arbitrary points xValues, split over numThreads
+    */
+    template<typename Number, typename CFDiscrete>
+    void computePointSumsAtPoints(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF, GridSums& sums, int numThreads){
+        sums.sinOverU.resize(xValues.size());
+        sums.cosMinusOneOverUSquared.resize(xValues.size());
+        const int numPoints=static_cast<int>(xValues.size());
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1)
+        for(int j=0; j<numPoints; ++j){
+            const auto pointSums=computePointSums(xValues[j], xMin, xMax, discreteCF);
+            sums.sinOverU[j]=pointSums.sinOverU;
+            sums.cosMinusOneOverUSquared[j]=pointSums.cosMinusOneOverUSquared;
+        }
+    }
+    #ifdef CFDISTUTILITIES_SIMD
+    /**
+        Contiguous double precision coefficients evaluate simdLanes points 
+        per pass over the coefficients.
+    */
+    inline void computePointSumsAtPoints(const std::vector<double>& xValues, const double& xMin, const double& xMax, const DiscreteCFView<double>& discreteCF, GridSums& sums, int numThreads){
+        const std::size_t numPoints=xValues.size();
+        sums.sinOverU.resize(numPoints);
+        sums.cosMinusOneOverUSquared.resize(numPoints);
+        const double du=fangoost::computeDU(xMin, xMax);
+        const int numBlocks=static_cast<int>(numPoints/simdLanes);
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1)
+        for(int block=0; block<numBlocks; ++block){
+            const std::size_t first=block*simdLanes;
+            double theta[simdLanes];
+            for(std::size_t l=0; l<simdLanes; ++l){
+                theta[l]=(xValues[first+l]-xMin)*du;
+            }
+            computePointSumsLanesKernel(discreteCF.data(), discreteCF.size(), theta, du, sums.sinOverU.data()+first, sums.cosMinusOneOverUSquared.data()+first);
+        }
+        for(std::size_t j=numBlocks*simdLanes; j<numPoints; ++j){
+            const auto pointSums=computePointSums(xValues[j], xMin, xMax, discreteCF);
+            sums.sinOverU[j]=pointSums.sinOverU;
+            sums.cosMinusOneOverUSquared[j]=pointSums.cosMinusOneOverUSquared;
+        }
+    }
+    #endif
+
+    /**
+        CDF and partial expectation at every point of xValues, which need 
+        not be sorted or on a grid.  The coefficients are computed once for
+        all points.
+    */
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computeCDFAtPointsHelper(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF, int numThreads, Stats& stats){
+        const auto start=stats.startStage();
+        GridSums sums;
+        computePointSumsAtPoints(xValues, xMin, xMax, viewOf(discreteCF), sums, numThreads);
+        const Number halfFirst=discreteCF.size()>0?.5*discreteCF[0]:0.0;
+        std::vector<Number> cdf(xValues.size());
+        for(std::size_t j=0; j<xValues.size(); ++j){
+            cdf[j]=halfFirst*(xValues[j]-xMin)+sums.sinOverU[j];
+        }
+        stats.endSolver(start, 0.0);
+        return cdf;
+    }
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computePartialExpectationAtPointsHelper(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, const CFDiscrete& discreteCF, int numThreads, Stats& stats){
+        const auto start=stats.startStage();
+        GridSums sums;
+        computePointSumsAtPoints(xValues, xMin, xMax, viewOf(discreteCF), sums, numThreads);
+        const Number halfFirst=discreteCF.size()>0?.5*discreteCF[0]:0.0;
+        std::vector<Number> expectation(xValues.size());
+        for(std::size_t j=0; j<xValues.size(); ++j){
+            expectation[j]=halfFirst*diffPow(xValues[j], xMin)+xValues[j]*sums.sinOverU[j]+sums.cosMinusOneOverUSquared[j];
+        }
+        stats.endSolver(start, 0.0);
+        return expectation;
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoints(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        NoStats stats;
+        return computeCDFAtPointsHelper(xValues, xMin, xMax, discreteCF, 1, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        NoStats stats;
+        return computeCDFAtPointsHelper(xValues, xMin, xMax, discreteCF, getNumThreads(policy), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoints(const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computeCDFAtPoints(xValues, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computeCDFAtPoints(policy, xValues, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computePartialExpectationAtPoints(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        NoStats stats;
+        return computePartialExpectationAtPointsHelper(xValues, xMin, xMax, discreteCF, 1, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computePartialExpectationAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        NoStats stats;
+        return computePartialExpectationAtPointsHelper(xValues, xMin, xMax, discreteCF, getNumThreads(policy), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectationAtPoints(const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computePartialExpectationAtPoints(xValues, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectationAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf){
+        return computePartialExpectationAtPoints(policy, xValues, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    /**
+        The point functions also take a trailing SolverStats; as for the 
+        grid functions the time spent on the points is recorded as solver 
+        time
+    */
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computeCDFAtPointsHelper(xValues, xMin, xMax, discreteCF, getNumThreads(policy), stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAtPoints(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computeCDFAtPoints(seq, xValues, xMin, xMax, discreteCF, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computeCDFAtPoints(policy, xValues, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeCDFAtPoints(const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computeCDFAtPoints(seq, xValues, numU, xMin, xMax, cf, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computePartialExpectationAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computePartialExpectationAtPointsHelper(xValues, xMin, xMax, discreteCF, getNumThreads(policy), stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computePartialExpectationAtPoints(const std::vector<Number>& xValues, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+        return computePartialExpectationAtPoints(seq, xValues, xMin, xMax, discreteCF, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectationAtPoints(const ParallelPolicy& policy, const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computePartialExpectationAtPoints(policy, xValues, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computePartialExpectationAtPoints(const std::vector<Number>& xValues, const Index& numU, const Number& xMin, const Number& xMax, CF&& cf, SolverStats& stats){
+        return computePartialExpectationAtPoints(seq, xValues, numU, xMin, xMax, cf, stats);
+    }
+
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computeVaRNewtonHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2, Stats& stats){
+        //the CDF and the density come from one pass with the rotation recurrence
+        const auto start=stats.startStage();
+        Number lower=xMin;
+        Number upper=xMax;
+        Number x=guess;
+        for(int i=0; i<50; ++i){
+            stats.addIteration();
+            const auto evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+            const Number f=evaluation.cdf-alpha;
+            if(std::abs(f)<prec1){
+                break;
+            }
+            if(x>lower&&x<upper){
+                if(f<0){
+                    lower=x;
+                }
+                else{
+                    upper=x;
+                }
+            }
+            //where the density vanishes the Newton step is undefined, so bisect instead
+            const Number next=evaluation.pdf>0.0?x-f/evaluation.pdf:.5*(lower+upper);
+            const bool isConverged=std::abs(next-x)<prec2;
+            x=next;
+            if(isConverged){
+                break;
+            }
+        }
+        stats.endSolver(start, 0.0);
+        return -x;
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2){
+        NoStats stats;
+        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, discreteCF, prec1, prec2, stats);
+    }
+
+    /**
+        Computes the CDF and the density at xValue in a single pass over the 
+        discrete CF.  Returns a tuple of CDF and density.
+    */
+    template<typename Number, typename CFDiscrete>
+    auto computeCDFAndPDFAtPoint(const Number& xValue, const Number& xMin, const Number& xMax, CFDiscrete&& discreteCF){
+        const auto evaluation=evaluatePoint(xValue, xMin, xMax, discreteCF);
+        return std::make_tuple(evaluation.cdf, evaluation.pdf);
+    }
+
+    /**
+        Newton's method safeguarded by bisection.  The CDF and its derivative
+        come from the same pass over the coefficients.  Any Newton step which 
+        leaves the current bracket (or any non-positive density) is replaced 
+        by a bisection step, so the method is as robust as computeVaRHelper.
+    */
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computeVaRNewtonBisectHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2, Stats& stats, int maxIterations=200){
+        const auto start=stats.startStage();
+        Number lower=xMin;
+        Number upper=xMax;
+        Number x=guess>lower&&guess<upper?guess:.5*(lower+upper);
+        for(int i=0; i<maxIterations; ++i){
+            stats.addIteration();
+            const auto evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+            const auto objective=evaluation.cdf-alpha;
+            const auto density=evaluation.pdf;
+            if(std::abs(objective)<prec1){
+                stats.endSolver(start, upper-lower);
+                return -x;
+            }
+            if(objective<0){
+                lower=x;
+            }
+            else{
+                upper=x;
+            }
+            auto next=density>0?x-objective/density:upper;
+            if(!(next>lower&&next<upper)){
+                next=.5*(lower+upper);
+            }
+            if(std::abs(next-x)<prec2){
+                stats.endSolver(start, upper-lower);
+                return -next;
+            }
+            x=next;
+        }
+        stats.endSolver(start, upper-lower);
+        return -x;
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonBisectHelper(const Number& alpha, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& discreteCF, const Number& prec1, const Number& prec2, int maxIterations=200){
+        NoStats stats;
+        return computeVaRNewtonBisectHelper(alpha, xMin, xMax, guess, discreteCF, prec1, prec2, stats, maxIterations);
+    }
+
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        return computeVaRHelper(alpha, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)), prec, prec);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf){
+        const auto xRange=computeDomain(domain, cf);
+        return computeVaR(alpha, prec, xRange.first, xRange.second, numU, std::move(cf));
+    }
+    /**
+        Every entry point below also takes a trailing SolverStats, which 
+        records where the time of the call went.
+    */
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeVaRHelper(alpha, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), prec, prec, SolverOptions(), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, SolverStats& stats){
+        const auto xRange=computeDomainWithStats(domain, cf, stats);
+        return computeVaR(alpha, prec, xRange.first, xRange.second, numU, cf, stats);
+    }
+    /**
+        computeVaR, computeVaRDiscrete, computeES and computeESDiscrete also 
+        take a trailing SolverOptions (and then optionally a SolverStats) 
+        to choose the bracketing method
+    */
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, const SolverOptions& options, SolverStats& stats){
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        return computeVaRHelper(alpha, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), prec, prec, optionsWithCumulants, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, const SolverOptions& options){
+        NoStats stats;
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        return computeVaRHelper(alpha, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)), prec, prec, optionsWithCumulants, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, const SolverOptions& options, SolverStats& stats){
+        //the cumulants of the cumulant bracket also give the domain
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        const auto xRange=optionsWithCumulants.hasCumulants?computeCumulantDomain(domain, optionsWithCumulants.cumulants):computeDomainWithStats(domain, cf, stats);
+        return computeVaR(alpha, prec, xRange.first, xRange.second, numU, cf, optionsWithCumulants, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaR(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, const SolverOptions& options){
+        NoStats stats;
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        const auto xRange=optionsWithCumulants.hasCumulants?computeCumulantDomain(domain, optionsWithCumulants.cumulants):computeDomain(domain, cf);
+        return computeVaR(alpha, prec, xRange.first, xRange.second, numU, std::move(cf), optionsWithCumulants);
+    }
+    /**Newton is faster but not as stable*/
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewton(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, const Index& numU, CF&& cf){
+        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, computeDiscreteCF(xMin, xMax, numU, std::move(cf)), prec1, prec2);
+    }
+
+    /**
+        Cornish-Fisher estimate of the alpha quantile moved inside the 
+        domain, used as the guess when Newton is not given one
+    */
+    template<typename Number, typename CF, typename Stats>
+    Number computeCornishFisherGuess(const Number& alpha, const Number& xMin, const Number& xMax, const CF& cf, Stats& stats){
+        return std::min(std::max(computeCornishFisherQuantile(alpha, computeCumulantsWithStats(cf, stats)), xMin), xMax);
+    }
+
+    /**Starts Newton from the Cornish-Fisher estimate of the quantile*/
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewton(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        NoStats stats;
+        const Number guess=computeCornishFisherGuess(alpha, xMin, xMax, cf, stats);
+        return computeVaRNewton(alpha, prec1, prec2, xMin, xMax, guess, numU, std::move(cf));
+    }
+
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonDiscrete(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& cf){
+        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, cf, prec1, prec2);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewton(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), prec1, prec2, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewton(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        const Number guess=computeCornishFisherGuess(alpha, xMin, xMax, cf, stats);
+        return computeVaRNewton(alpha, prec1, prec2, xMin, xMax, guess, numU, cf, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonDiscrete(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& cf, SolverStats& stats){
+        return computeVaRNewtonHelper(alpha, xMin, xMax, guess, cf, prec1, prec2, stats);
+    }
+
+    /**Newton's speed with the robustness of bisection*/
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewtonBisect(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, const Index& numU, CF&& cf){
+        return computeVaRNewtonBisectHelper(alpha, xMin, xMax, guess, computeDiscreteCF(xMin, xMax, numU, std::move(cf)), prec1, prec2);
+    }
+
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewtonBisect(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        NoStats stats;
+        const Number guess=computeCornishFisherGuess(alpha, xMin, xMax, cf, stats);
+        return computeVaRNewtonBisect(alpha, prec1, prec2, xMin, xMax, guess, numU, std::move(cf));
+    }
+
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonBisectDiscrete(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& cf){
+        return computeVaRNewtonBisectHelper(alpha, xMin, xMax, guess, cf, prec1, prec2);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewtonBisect(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeVaRNewtonBisectHelper(alpha, xMin, xMax, guess, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), prec1, prec2, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRNewtonBisect(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        const Number guess=computeCornishFisherGuess(alpha, xMin, xMax, cf, stats);
+        return computeVaRNewtonBisect(alpha, prec1, prec2, xMin, xMax, guess, numU, cf, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRNewtonBisectDiscrete(const Number& alpha, const Number& prec1, const Number& prec2, const Number& xMin, const Number& xMax, const Number& guess, CFDiscrete&& cf, SolverStats& stats){
+        return computeVaRNewtonBisectHelper(alpha, xMin, xMax, guess, cf, prec1, prec2, stats);
+    }
+
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf){
+        return computeVaRHelper(alpha, xMin, xMax, cf, prec, prec);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, SolverStats& stats){
+        return computeVaRHelper(alpha, xMin, xMax, cf, prec, prec, SolverOptions(), stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, const SolverOptions& options, SolverStats& stats){
+        return computeVaRHelper(alpha, xMin, xMax, cf, prec, prec, options, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, const SolverOptions& options){
+        NoStats stats;
+        return computeVaRHelper(alpha, xMin, xMax, cf, prec, prec, options, stats);
+    }
+
+    /**
+        Computes the VaR for every alpha in alphas using a single discrete CF.  
+        The alphas are solved in increasing order, so the root of each one 
+        bounds the next from below, and the evaluations above that root 
+        which have a CDF over the next alpha bound it from above.  A root 
+        already within prec of the next alpha is its root too.  Results are
+        returned in the order of the input alphas.
+    */
+    template<typename Number, typename CFDiscrete, typename Stats>
+    auto computeVaRBatchHelper(const std::vector<Number>& alphas, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, Stats& stats){
+        const auto start=stats.startStage();
+        std::vector<std::size_t> order(alphas.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](const auto& left, const auto& right){
+            return alphas[left]<alphas[right];
+        });
+        std::vector<Number> results(alphas.size());
+        //evaluations to the right of the last root, as (x, CDF)
+        std::vector<std::pair<Number, Number>> above;
+        bool hasRoot=false;
+        Number root=xMin;
+        Number rootCDF=0.0;
+        Number lastWidth=xMax-xMin;
+        for(const auto index:order){
+            const Number alpha=alphas[index];
+            if(hasRoot&&std::abs(rootCDF-alpha)<=prec){
+                results[index]=-root;
+                continue;
+            }
+            //the cosine expansion need not be monotone in the tails
+            Number lower=hasRoot&&rootCDF<alpha?root:xMin;
+            Number upper=xMax;
+            for(const auto& point:above){
+                if(point.second>alpha&&point.first>lower&&point.first<upper){
+                    upper=point.first;
+                }
+            }
+            const auto evaluate=[&](const Number& x){
+                stats.addIteration();
+                const Number cdf=evaluatePoint(x, xMin, xMax, cf).cdf;
+                above.emplace_back(x, cdf);
+                return cdf;
+            };
+            Number x=.5*(lower+upper);
+            Number cdf=evaluate(x);
+            while(std::abs(cdf-alpha)>prec&&.5*(upper-lower)>prec){
+                if(cdf<alpha){
+                    lower=x;
+                }
+                else{
+                    upper=x;
+                }
+                x=.5*(lower+upper);
+                cdf=evaluate(x);
+            }
+            above.erase(std::remove_if(above.begin(), above.end(), [&](const auto& point){
+                return point.first<=x;
+            }), above.end());
+            hasRoot=true;
+            root=x;
+            rootCDF=cdf;
+            lastWidth=upper-lower;
+            results[index]=-x;
+        }
+        stats.endSolver(start, lastWidth);
+        return results;
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRBatchDiscrete(const std::vector<Number>& alphas, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf){
+        NoStats stats;
+        return computeVaRBatchHelper(alphas, prec, xMin, xMax, cf, stats);
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeVaRBatchDiscrete(const std::vector<Number>& alphas, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, SolverStats& stats){
+        return computeVaRBatchHelper(alphas, prec, xMin, xMax, cf, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRBatch(const std::vector<Number>& alphas, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        return computeVaRBatchDiscrete(alphas, prec, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeVaRBatch(const std::vector<Number>& alphas, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeVaRBatchDiscrete(alphas, prec, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+
+    constexpr int ES=0;
+    constexpr int VAR=1;
+    /**
+     * returns tuple of ES and VaR
+     */
+    template<typename Number,typename CFDiscrete, typename Stats>
+    auto computeESHelper(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, const SolverOptions& options, Stats& stats){
+        //the partial expectation at the root comes from the final step of the solver
+        const auto root=solveCDF(alpha, xMin, xMax, xMin, xMax, cf, prec, prec, options, stats);
+        return std::make_tuple(
+            -root.evaluation.expectation/alpha, 
+            -root.x
+        );
+    }
+    template<typename Number,typename CFDiscrete>
+    auto computeESDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf){
+        NoStats stats;
+        return computeESHelper(alpha, prec, xMin, xMax, cf, SolverOptions(), stats);
+    }
+    template<typename Number,typename CFDiscrete>
+    auto computeESDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, SolverStats& stats){
+        return computeESHelper(alpha, prec, xMin, xMax, cf, SolverOptions(), stats);
+    }
+    template<typename Number,typename CFDiscrete>
+    auto computeESDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, const SolverOptions& options){
+        NoStats stats;
+        return computeESHelper(alpha, prec, xMin, xMax, cf, options, stats);
+    }
+    template<typename Number,typename CFDiscrete>
+    auto computeESDiscrete(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, CFDiscrete&& cf, const SolverOptions& options, SolverStats& stats){
+        return computeESHelper(alpha, prec, xMin, xMax, cf, options, stats);
+    }
+    /**
+     * returns tuple of ES and VaR
+     */
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        return computeESDiscrete(alpha, prec, xMin, xMax, 
+            computeDiscreteCF(xMin, xMax, numU, std::move(cf))
+        );
+    }
+    
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf){
+        const auto xRange=computeDomain(domain, cf);
+        return computeES(alpha, prec, xRange.first, xRange.second, numU, std::move(cf));
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeESDiscrete(alpha, prec, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, SolverStats& stats){
+        const auto xRange=computeDomainWithStats(domain, cf, stats);
+        return computeES(alpha, prec, xRange.first, xRange.second, numU, cf, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, const SolverOptions& options, SolverStats& stats){
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        return computeESDiscrete(alpha, prec, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), optionsWithCumulants, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, const SolverOptions& options){
+        NoStats stats;
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        return computeESDiscrete(alpha, prec, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)), optionsWithCumulants);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, const SolverOptions& options, SolverStats& stats){
+        //the cumulants of the cumulant bracket also give the domain
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        const auto xRange=optionsWithCumulants.hasCumulants?computeCumulantDomain(domain, optionsWithCumulants.cumulants):computeDomainWithStats(domain, cf, stats);
+        return computeES(alpha, prec, xRange.first, xRange.second, numU, cf, optionsWithCumulants, stats);
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeES(const Number& alpha, const Number& prec, const AutoDomain& domain, const Index& numU, CF&& cf, const SolverOptions& options){
+        NoStats stats;
+        const auto optionsWithCumulants=addCumulants(options, cf, stats);
+        const auto xRange=optionsWithCumulants.hasCumulants?computeCumulantDomain(domain, optionsWithCumulants.cumulants):computeDomain(domain, cf);
+        return computeES(alpha, prec, xRange.first, xRange.second, numU, std::move(cf), optionsWithCumulants);
+    }
+    
+    template<typename Number, typename CFDiscrete>
+    auto computeELDiscrete(const Number& xMin, const Number& xMax, CFDiscrete&& cf){
+        return evaluatePoint(xMax, xMin, xMax, cf).expectation;
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeEL(const Number& xMin, const Number& xMax, const Index& numU, CF&& cf){
+        return computeELDiscrete(xMin, xMax, computeDiscreteCF(xMin, xMax, numU, std::move(cf)));
+    }
+    template<typename CF, typename Index>
+    auto computeEL(const AutoDomain& domain, const Index& numU, CF&& cf){
+        const auto xRange=computeDomain(domain, cf);
+        return computeEL(xRange.first, xRange.second, numU, std::move(cf));
+    }
+    template<typename Number, typename CFDiscrete>
+    auto computeELDiscrete(const Number& xMin, const Number& xMax, CFDiscrete&& cf, SolverStats& stats){
+        const auto start=stats.startStage();
+        const auto expectation=computeELDiscrete(xMin, xMax, cf);
+        stats.endSolver(start, 0.0);
+        return expectation;
+    }
+    template<typename Number, typename CF, typename Index>
+    auto computeEL(const Number& xMin, const Number& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+        return computeELDiscrete(xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), stats);
+    }
+    template<typename CF, typename Index>
+    auto computeEL(const AutoDomain& domain, const Index& numU, CF&& cf, SolverStats& stats){
+        const auto xRange=computeDomainWithStats(domain, cf, stats);
+        return computeEL(xRange.first, xRange.second, numU, cf, stats);
+    }
+
+    /**
+        A loan which loses exposure*lgd with probability pd
+    */
+    struct Loan{
+        double exposure;
+        double pd;
+        double lgd;
+    };
+    /**
+        count loans with the same exposure, pd and lgd; see bucketLoans
+    */
+    struct LoanBucket{
+        Loan loan;
+        std::size_t count;
+    };
+    inline const Loan& getLoan(const Loan& loan){
+        return loan;
+    }
+    inline const Loan& getLoan(const LoanBucket& bucket){
+        return bucket.loan;
+    }
+    inline double getCount(const Loan&){
+        return 1.0;
+    }
+    inline double getCount(const LoanBucket& bucket){
+        return static_cast<double>(bucket.count);
+    }
+    /**
+        Adds log(1-pd+pd*exp(-i u_k w)), w=exposure*lgd, at u_k=k*du to 
+        logCF.  Losses are negative so that VaR and ES of the portfolio have
+        the same sign convention as for any other CF.  exp(-i u_k w) comes 
+        from the same re-seeded rotation recurrence as computePointSums.  
+        weight=n adds n identical loans and weight=-1 removes a loan added 
+        before.
+    */
+    inline void addLoanLogCF(const Loan& loan, double du, std::size_t numU, std::complex<double>* logCF, double weight=1.0){
+        const double w=loan.exposure*loan.lgd;
+        const auto step=std::polar(1.0, -du*w);
+        std::complex<double> rotation(1.0, 0.0);
+        for(std::size_t k=0; k<numU; ++k){
+            rotation=k%reseedInterval==0?std::polar(1.0, -(k*du)*w):multiplyComplex(rotation, step);
+            const double real=1.0+loan.pd*(rotation.real()-1.0);
+            const double imag=loan.pd*rotation.imag();
+            logCF[k]+=weight*std::complex<double>(.5*log(real*real+imag*imag), atan2(imag, real));
+        }
+    }
+
+    /**
+        Log CF of the portfolio loss at u_k=k*du, k=0..numU-1, for the 
+        domain xMin to xMax.  Loans are independent, so the log CFs add; 
+        summing logs rather than multiplying CFs avoids underflow for large
+        portfolios.  Each of numThreads threads accumulates a contiguous 
+        block of loans into its own numU terms, and the blocks are added in
+        order, so memory is numThreads*numU whatever the number of loans and
+        the result is the same on every run with the same numThreads.  
+        loans may be Loan or LoanBucket.
+    */
+    template<typename Position, typename Index>
+    auto computePortfolioLogCF(const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU, int numThreads=1){
+        const std::size_t numTerms=numU;
+        const double du=fangoost::computeDU(xMin, xMax);
+        const std::size_t numBlocks=std::max<std::size_t>(std::min<std::size_t>(std::max(numThreads, 1), loans.size()), 1);
+        std::vector<std::complex<double> > blockLogCF(numBlocks*numTerms);
+        const int numTasks=static_cast<int>(numBlocks);
+        #pragma omp parallel for num_threads(numTasks) schedule(static) if(numTasks>1)
+        for(int block=0; block<numTasks; ++block){
+            const std::size_t first=block*loans.size()/numBlocks;
+            const std::size_t last=(block+1)*loans.size()/numBlocks;
+            for(std::size_t i=first; i<last; ++i){
+                addLoanLogCF(getLoan(loans[i]), du, numTerms, blockLogCF.data()+block*numTerms, getCount(loans[i]));
+            }
+        }
+        if(numBlocks==1){
+            return blockLogCF;
+        }
+        std::vector<std::complex<double> > logCF(numTerms);
+        for(std::size_t block=0; block<numBlocks; ++block){
+            for(std::size_t k=0; k<numTerms; ++k){
+                logCF[k]+=blockLogCF[block*numTerms+k];
+            }
+        }
+        return logCF;
+    }
+    template<typename Position, typename Index>
+    auto computePortfolioLogCF(const ParallelPolicy& policy, const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU){
+        return computePortfolioLogCF(loans, xMin, xMax, numU, getNumThreads(policy));
+    }
+
+    /**
+        The discrete CF, as from computeDiscreteCF, from the log CF at 
+        u_k=k*du
+    */
+    inline void computeDiscreteCFFromLogCF(const double& xMin, const double& xMax, const std::vector<std::complex<double> >& logCF, std::vector<double>& discreteCF){
+        const double du=fangoost::computeDU(xMin, xMax);
+        const double cp=fangoost::computeCP(du);
+        discreteCF.resize(logCF.size());
+        for(std::size_t k=0; k<logCF.size(); ++k){
+            discreteCF[k]=cp*exp(logCF[k].real())*cos(logCF[k].imag()-(k*du)*xMin);
+        }
+    }
+    inline std::vector<double> computeDiscreteCFFromLogCF(const double& xMin, const double& xMax, const std::vector<std::complex<double> >& logCF){
+        std::vector<double> discreteCF;
+        computeDiscreteCFFromLogCF(xMin, xMax, logCF, discreteCF);
+        return discreteCF;
+    }
+
+    /**
+        The discrete CF of the portfolio loss, for computeVaRDiscrete, 
+        computeESDiscrete and the other Discrete functions
+    */
+    template<typename Position, typename Index>
+    auto computePortfolioDiscreteCF(const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU, int numThreads=1){
+        return computeDiscreteCFFromLogCF(xMin, xMax, computePortfolioLogCF(loans, xMin, xMax, numU, numThreads));
+    }
+    template<typename Position, typename Index>
+    auto computePortfolioDiscreteCF(const ParallelPolicy& policy, const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU){
+        return computePortfolioDiscreteCF(loans, xMin, xMax, numU, getNumThreads(policy));
+    }
+
+    /**
+        Exact first four cumulants of the portfolio loss, for computeDomain
+    */
+    template<typename Position>
+    std::array<double, 4> computePortfolioCumulants(const std::vector<Position>& loans){
+        std::array<double, 4> cumulants{{0.0, 0.0, 0.0, 0.0}};
+        for(const auto& position:loans){
+            const auto& loan=getLoan(position);
+            const double n=getCount(position);
+            const double w=loan.exposure*loan.lgd;
+            const double p=loan.pd;
+            const double variance=p*(1.0-p);
+            cumulants[0]-=n*w*p;
+            cumulants[1]+=n*w*w*variance;
+            cumulants[2]-=n*w*w*w*variance*(1.0-2.0*p);
+            cumulants[3]+=n*w*w*w*w*variance*(1.0-6.0*variance);
+        }
+        return cumulants;
+    }
+    template<typename Position>
+    auto computePortfolioDomain(const AutoDomain& domain, const std::vector<Position>& loans){
+        return computeCumulantDomain(domain, computePortfolioCumulants(loans));
+    }
+
+    /**
+        Rounding steps for bucketLoans.  Each field is rounded to the nearest
+        multiple of its step; a step of zero requires an exact match.
+    */
+    struct BucketTolerance{
+        double exposure;
+        double pd;
+        double lgd;
+    };
+    inline double roundToStep(double value, double step){
+        return step>0.0?std::round(value/step)*step:value;
+    }
+    /**
+        Groups loans whose rounded exposure, pd and lgd agree.  Each bucket 
+        holds the mean exposure, pd and lgd of its loans, so with zero 
+        tolerances bucketing is exact.  Buckets are ordered by their rounded 
+        fields.
+    */
+    inline std::vector<LoanBucket> bucketLoans(const std::vector<Loan>& loans, const BucketTolerance& tolerance=BucketTolerance{0.0, 0.0, 0.0}){
+        const auto getKey=[&](const Loan& loan){
+            return std::make_tuple(
+                roundToStep(loan.exposure, tolerance.exposure), 
+                roundToStep(loan.pd, tolerance.pd), 
+                roundToStep(loan.lgd, tolerance.lgd)
+            );
+        };
+        std::vector<std::size_t> order(loans.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](const auto& left, const auto& right){
+            return getKey(loans[left])<getKey(loans[right]);
+        });
+        std::vector<LoanBucket> buckets;
+        for(std::size_t i=0; i<order.size();){
+            const auto key=getKey(loans[order[i]]);
+            Loan total{0.0, 0.0, 0.0};
+            std::size_t count=0;
+            for(; i<order.size()&&getKey(loans[order[i]])==key; ++i, ++count){
+                total.exposure+=loans[order[i]].exposure;
+                total.pd+=loans[order[i]].pd;
+                total.lgd+=loans[order[i]].lgd;
+            }
+            buckets.push_back(LoanBucket{Loan{total.exposure/count, total.pd/count, total.lgd/count}, count});
+        }
+        return buckets;
+    }
+
+    /**
+        Size of the bucketed portfolio and its VaR against that of the exact
+        aggregation
+    */
+    struct BucketingReport{
+        std::size_t numLoans;
+        std::size_t numBuckets;
+        double exactVaR;
+        double bucketedVaR;
+        double changeInVaR;
+    };
+    template<typename Index>
+    auto computeBucketingReport(const double& alpha, const double& prec, const std::vector<Loan>& loans, const std::vector<LoanBucket>& buckets, const double& xMin, const double& xMax, const Index& numU, int numThreads=1){
+        const double exactVaR=computeVaRDiscrete(alpha, prec, xMin, xMax, computePortfolioDiscreteCF(loans, xMin, xMax, numU, numThreads));
+        const double bucketedVaR=computeVaRDiscrete(alpha, prec, xMin, xMax, computePortfolioDiscreteCF(buckets, xMin, xMax, numU, numThreads));
+        return BucketingReport{loans.size(), buckets.size(), exactVaR, bucketedVaR, bucketedVaR-exactVaR};
+    }
+
+    /**
+        Portfolio whose log CF on the u grid is kept, so that adding or 
+        removing a loan costs O(numU) and a what-if VaR or ES needs only the
+        root search.  The domain is fixed on construction, so it should be 
+        wide enough for the portfolios to be tried, e.g. from 
+        computePortfolioDomain.
+    */
+    class IncrementalPortfolio{
+    public:
+        template<typename Index>
+        IncrementalPortfolio(const std::vector<Loan>& loans, const double& xMin_, const double& xMax_, const Index& numU, int numThreads=1):
+            xMin(xMin_), 
+            xMax(xMax_), 
+            du(fangoost::computeDU(xMin_, xMax_)), 
+            logCF(computePortfolioLogCF(loans, xMin_, xMax_, numU, numThreads)),
+            discreteCF(logCF.size()),
+            isDiscreteCFCurrent(false){}
+        void add(const Loan& loan){
+            addLoanLogCF(loan, du, logCF.size(), logCF.data());
+            isDiscreteCFCurrent=false;
+        }
+        /**loan must have been added before, on construction or by add*/
+        void remove(const Loan& loan){
+            addLoanLogCF(loan, du, logCF.size(), logCF.data(), -1.0);
+            isDiscreteCFCurrent=false;
+        }
+        const std::vector<double>& getDiscreteCF(){
+            if(!isDiscreteCFCurrent){
+                computeDiscreteCFFromLogCF(xMin, xMax, logCF, discreteCF);
+                isDiscreteCFCurrent=true;
+            }
+            return discreteCF;
+        }
+        double var(const double& alpha, const double& prec=.0000001){
+            return computeVaRDiscrete(alpha, prec, xMin, xMax, getDiscreteCF());
+        }
+        double es(const double& alpha, const double& prec=.0000001){
+            return std::get<ES>(computeESDiscrete(alpha, prec, xMin, xMax, getDiscreteCF()));
+        }
+    private:
+        double xMin;
+        double xMax;
+        double du;
+        std::vector<std::complex<double> > logCF;
+        std::vector<double> discreteCF;
+        bool isDiscreteCFCurrent;
+    };
+
+
+    /**
+        Euler allocation of the portfolio VaR and ES to its positions.  The 
+        contributions of a LoanBucket are those of all of its loans, and 
+        the contributions add up to var and es.
+    */
+    struct RiskContributions{
+        double var;
+        double es;
+        std::vector<double> varContributions;
+        std::vector<double> esContributions;
+    };
+
+    /**
+        Computes VaR and ES and their Euler contributions 
+        E[loss_i|X=x*]=w_i g_i(x*)/f(x*) and E[loss_i|X<=x*]=w_i G_i(x*)/alpha
+        at the root x* of CDF(x)=alpha.  g_i(x) is the density of X jointly 
+        with loan i defaulting, with CF pd*exp(-z w_i)*phi(z)/phi_i(z), and 
+        G_i its integral; both come from the COS expansion at x*, whose 
+        cos(u_k(x*-xMin)) and sin(u_k(x*-xMin))/u_k terms are shared by all 
+        positions.  Cost is one ES computation plus O(positions*numU), with 
+        the positions split over numThreads.
+    */
+    template<typename Position, typename Index>
+    auto computeRiskContributions(const double& alpha, const double& prec, const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU, int numThreads=1){
+        const std::size_t numTerms=numU;
+        const auto logCF=computePortfolioLogCF(loans, xMin, xMax, numU, numThreads);
+        const auto discreteCF=computeDiscreteCFFromLogCF(xMin, xMax, logCF);
+        const auto root=bisectCDF(alpha, xMin, xMax, xMin, xMax, discreteCF, prec, prec);
+        const double du=fangoost::computeDU(xMin, xMax);
+        const double cp=fangoost::computeCP(du);
+        //cp*phi(iu_k)*exp(-iu_k xMin), and the density and CDF terms at x*
+        std::vector<std::complex<double> > shiftedCF(numTerms);
+        std::vector<double> densityTerms(numTerms);
+        std::vector<double> cdfTerms(numTerms);
+        for(std::size_t k=0; k<numTerms; ++k){
+            const double u=k*du;
+            shiftedCF[k]=std::polar(cp*exp(logCF[k].real()), logCF[k].imag()-u*xMin);
+            densityTerms[k]=k==0?.5:cos(u*(root.x-xMin));
+            cdfTerms[k]=k==0?.5*(root.x-xMin):sin(u*(root.x-xMin))/u;
+        }
+        RiskContributions contributions{-root.x, -root.evaluation.expectation/alpha, std::vector<double>(loans.size()), std::vector<double>(loans.size())};
+        const int numPositions=static_cast<int>(loans.size());
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1)
+        for(int i=0; i<numPositions; ++i){
+            const auto& loan=getLoan(loans[i]);
+            const double w=loan.exposure*loan.lgd;
+            const auto step=std::polar(1.0, -du*w);
+            std::complex<double> rotation(1.0, 0.0);
+            double density=0.0;
+            double cdf=0.0;
+            for(std::size_t k=0; k<numTerms; ++k){
+                rotation=k%reseedInterval==0?std::polar(1.0, -(k*du)*w):multiplyComplex(rotation, step);
+                //pd*rotation/phi_i=pd*rotation*conj(phi_i)/|phi_i|^2
+                const std::complex<double> loanCF(1.0+loan.pd*(rotation.real()-1.0), loan.pd*rotation.imag());
+                const auto ratio=multiplyComplex(rotation, std::conj(loanCF))*(loan.pd/std::norm(loanCF));
+                const double term=multiplyComplex(shiftedCF[k], ratio).real();
+                density+=term*densityTerms[k];
+                cdf+=term*cdfTerms[k];
+            }
+            const double loss=getCount(loans[i])*w;
+            contributions.varContributions[i]=loss*density/root.evaluation.pdf;
+            contributions.esContributions[i]=loss*cdf/alpha;
+        }
+        return contributions;
+    }
+    template<typename Position, typename Index>
+    auto computeRiskContributions(const ParallelPolicy& policy, const double& alpha, const double& prec, const std::vector<Position>& loans, const double& xMin, const double& xMax, const Index& numU){
+        return computeRiskContributions(alpha, prec, loans, xMin, xMax, numU, getNumThreads(policy));
+    }
+
+
+    /**
+        Result of one scenario of computeScenarios and the wall time it took
+    */
+    template<typename Value>
+    struct ScenarioResult{
+        Value value;
+        std::chrono::nanoseconds duration;
+    };
+
+    /**
+        Evaluates fn(parameters[i]) for every scenario over numThreads 
+        threads.  Scenarios can differ a lot in cost (hard ones take more 
+        bisection steps), so they are handed out one at a time to whichever
+        thread is free rather than split evenly up front.  Results are in 
+        the order of parameters.  If any scenario throws, the exception of 
+        the first such scenario is rethrown once all have finished.
+    */
+    template<typename Parameters, typename Fn>
+    auto computeScenarios(const std::vector<Parameters>& parameters, Fn&& fn, int numThreads=1){
+        typedef std::decay_t<decltype(fn(parameters[0]))> Value;
+        std::vector<ScenarioResult<Value> > results(parameters.size());
+        std::vector<std::exception_ptr> errors(parameters.size());
+        const int numScenarios=static_cast<int>(parameters.size());
+        #pragma omp parallel for num_threads(numThreads) schedule(dynamic, 1) if(numThreads>1)
+        for(int i=0; i<numScenarios; ++i){
+            const auto start=std::chrono::steady_clock::now();
+            try{
+                results[i].value=fn(parameters[i]);
+            }
+            catch(...){
+                errors[i]=std::current_exception();
+            }
+            results[i].duration=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start);
+        }
+        for(const auto& error:errors){
+            if(error){
+                std::rethrow_exception(error);
+            }
+        }
+        return results;
+    }
+    template<typename Parameters, typename Fn>
+    auto computeScenarios(const ParallelPolicy& policy, const std::vector<Parameters>& parameters, Fn&& fn){
+        return computeScenarios(parameters, fn, getNumThreads(policy));
+    }
+    /**
+        Scenarios given as closures taking no arguments
+    */
+    template<typename Task>
+    auto computeScenarios(const ParallelPolicy& policy, const std::vector<Task>& tasks){
+        return computeScenarios(tasks, [](const Task& task){
+            return task();
+        }, getNumThreads(policy));
+    }
+    template<typename Task>
+    auto computeScenarios(const std::vector<Task>& tasks){
+        return computeScenarios(seq, tasks);
+    }
+
+
+    /**
+        The CDF and partial expectation terms VkCDF and VkE on a fixed grid,
+        with the first term halved, stored as numU rows of numX.  These do 
+        not depend on the CF, so with a GridBasis every CF on the same grid
+        costs one matrix product.
+    */
+    struct GridBasis{
+        std::size_t numX;
+        std::size_t numU;
+        double xMin;
+        double xMax;
+        std::vector<double> cdf;
+        std::vector<double> expectation;
+    };
+    template<typename Index>
+    GridBasis computeGridBasis(const Index& numXDiscrete, const Index& numU, const double& xMin, const double& xMax){
+        const std::size_t numX=numXDiscrete;
+        const std::size_t numTerms=numU;
+        GridBasis basis{numX, numTerms, xMin, xMax, std::vector<double>(numX*numTerms), std::vector<double>(numX*numTerms)};
+        const double du=fangoost::computeDU(xMin, xMax);
+        const double dx=fangoost::computeDX(numX, xMin, xMax);
+        for(std::size_t k=0; k<numTerms; ++k){
+            const double u=k*du;
+            const double weight=k==0?.5:1.0;
+            for(std::size_t j=0; j<numX; ++j){
+                const double x=xMin+j*dx;
+                basis.cdf[k*numX+j]=weight*VkCDF(u, x, xMin, xMax, k);
+                basis.expectation[k*numX+j]=weight*VkE(u, x, xMin, xMax, k);
+            }
+        }
+        return basis;
+    }
+
+    /**
+        Block sizes of multiplyGridBasis: a block of basisBlockX grid points
+        of each row of the basis is used by basisBlockScenarios scenarios 
+        while it is in cache.
+    */
+    constexpr std::size_t basisBlockX=256;
+    constexpr std::size_t basisBlockScenarios=4;
+
+    /**
+        result[s][j]=sum_k values[k*numX+j]*discreteCFs[s][k].  The loop 
+        over j is innermost so that it vectorizes; grid blocks are split 
+        over numThreads.  Throws std::invalid_argument if a discrete CF has
+        fewer than basis.numU coefficients.
+    */
+    template<typename CFDiscrete>
+    auto multiplyGridBasis(const GridBasis& basis, const std::vector<double>& values, const std::vector<CFDiscrete>& discreteCFs, int numThreads){
+        const std::size_t numX=basis.numX;
+        const std::size_t numScenarios=discreteCFs.size();
+        for(std::size_t s=0; s<numScenarios; ++s){
+            if(discreteCFs[s].size()<basis.numU){
+                throw std::invalid_argument("discrete CF "+std::to_string(s)+" has "+std::to_string(discreteCFs[s].size())+" coefficients but the grid basis needs "+std::to_string(basis.numU));
+            }
+        }
+        std::vector<std::vector<double> > result(numScenarios, std::vector<double>(numX, 0.0));
+        const int numBlocks=static_cast<int>((numX+basisBlockX-1)/basisBlockX);
+        #pragma omp parallel for num_threads(numThreads) schedule(static) if(numThreads>1)
+        for(int block=0; block<numBlocks; ++block){
+            const std::size_t first=block*basisBlockX;
+            const std::size_t last=std::min(first+basisBlockX, numX);
+            std::size_t s=0;
+            for(; s+basisBlockScenarios<=numScenarios; s+=basisBlockScenarios){
+                double* out0=result[s].data();
+                double* out1=result[s+1].data();
+                double* out2=result[s+2].data();
+                double* out3=result[s+3].data();
+                for(std::size_t k=0; k<basis.numU; ++k){
+                    const double* row=values.data()+k*numX;
+                    const double f0=discreteCFs[s][k];
+                    const double f1=discreteCFs[s+1][k];
+                    const double f2=discreteCFs[s+2][k];
+                    const double f3=discreteCFs[s+3][k];
+                    for(std::size_t j=first; j<last; ++j){
+                        out0[j]+=f0*row[j];
+                        out1[j]+=f1*row[j];
+                        out2[j]+=f2*row[j];
+                        out3[j]+=f3*row[j];
+                    }
+                }
+            }
+            for(; s<numScenarios; ++s){
+                double* out=result[s].data();
+                for(std::size_t k=0; k<basis.numU; ++k){
+                    const double* row=values.data()+k*numX;
+                    const double f=discreteCFs[s][k];
+                    for(std::size_t j=first; j<last; ++j){
+                        out[j]+=f*row[j];
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+        CDFs on the grid of basis, one per discrete CF.  Each discrete CF 
+        needs at least basis.numU coefficients for basis.xMin and 
+        basis.xMax; std::invalid_argument is thrown otherwise.
+    */
+    template<typename CFDiscrete>
+    auto computeCDFs(const GridBasis& basis, const std::vector<CFDiscrete>& discreteCFs, int numThreads=1){
+        return multiplyGridBasis(basis, basis.cdf, discreteCFs, numThreads);
+    }
+    template<typename CFDiscrete>
+    auto computeCDFs(const ParallelPolicy& policy, const GridBasis& basis, const std::vector<CFDiscrete>& discreteCFs){
+        return computeCDFs(basis, discreteCFs, getNumThreads(policy));
+    }
+    template<typename CFDiscrete>
+    auto computePartialExpectations(const GridBasis& basis, const std::vector<CFDiscrete>& discreteCFs, int numThreads=1){
+        return multiplyGridBasis(basis, basis.expectation, discreteCFs, numThreads);
+    }
+    template<typename CFDiscrete>
+    auto computePartialExpectations(const ParallelPolicy& policy, const GridBasis& basis, const std::vector<CFDiscrete>& discreteCFs){
+        return computePartialExpectations(basis, discreteCFs, getNumThreads(policy));
+    }
+
+
+    /**
+        Quantiles of one distribution from its CDF tabulated on a grid, for 
+        repeated lookups.  The CDF comes from computeCDF (by transform for 
+        fine grids).  The cosine expansion can ring in the tails, so the 
+        table is made monotone by a running maximum and points where the 
+        CDF does not increase are dropped.  The inverse is the monotone cubic
+        (Fritsch-Carlson) interpolant of x as a function of the CDF, so a 
+        lookup is a binary search and a cubic.  quantile(alpha, true) 
+        polishes the result with one Newton step on the exact sum.
+    */
+    class QuantileTable{
+    public:
+        template<typename Index>
+        QuantileTable(const Index& numX, const double& xMin_, const double& xMax_, const std::vector<double>& discreteCF_):
+            xMin(xMin_), 
+            xMax(xMax_), 
+            discreteCF(discreteCF_){
+            NoStats stats;
+            build(numX, stats);
+        }
+        /**the time spent building the table is recorded as solver time*/
+        template<typename Index>
+        QuantileTable(const Index& numX, const double& xMin_, const double& xMax_, const std::vector<double>& discreteCF_, SolverStats& stats):
+            xMin(xMin_), 
+            xMax(xMax_), 
+            discreteCF(discreteCF_){
+            build(numX, stats);
+        }
+        template<typename CF, typename Index>
+        QuantileTable(const Index& numX, const Index& numU, const double& xMin_, const double& xMax_, CF&& cf):
+            QuantileTable(numX, xMin_, xMax_, computeDiscreteCF(xMin_, xMax_, numU, cf)){}
+        template<typename CF, typename Index>
+        QuantileTable(const Index& numX, const Index& numU, const double& xMin_, const double& xMax_, CF&& cf, SolverStats& stats):
+            QuantileTable(numX, xMin_, xMax_, computeDiscreteCFWithStats(xMin_, xMax_, numU, cf, stats), stats){}
+
+        /**x such that CDF(x)=alpha, clamped to the domain*/
+        double quantile(const double& alpha, bool polish=false) const{
+            if(cdfValues.empty()||alpha<=cdfValues.front()){
+                return cdfValues.empty()?xMin:xValues.front();
+            }
+            if(alpha>=cdfValues.back()){
+                return xValues.back();
+            }
+            const std::size_t j=std::upper_bound(cdfValues.begin(), cdfValues.end(), alpha)-cdfValues.begin()-1;
+            const double h=cdfValues[j+1]-cdfValues[j];
+            const double t=(alpha-cdfValues[j])/h;
+            const double t2=t*t;
+            const double t3=t2*t;
+            const double x=(2.0*t3-3.0*t2+1.0)*xValues[j]+(t3-2.0*t2+t)*h*slopes[j]
+                +(-2.0*t3+3.0*t2)*xValues[j+1]+(t3-t2)*h*slopes[j+1];
+            if(!polish){
+                return x;
+            }
+            const auto evaluation=evaluatePoint(x, xMin, xMax, discreteCF);
+            const double next=evaluation.pdf>0.0?x-(evaluation.cdf-alpha)/evaluation.pdf:x;
+            return next>xValues[j]&&next<xValues[j+1]?next:x;
+        }
+        double var(const double& alpha, bool polish=false) const{
+            return -quantile(alpha, polish);
+        }
+    private:
+        template<typename Index, typename Stats>
+        void build(const Index& numX, Stats& stats){
+            const auto start=stats.startStage();
+            const auto cdf=computeCDF(numX, xMin, xMax, discreteCF);
+            const double dx=fangoost::computeDX(numX, xMin, xMax);
+            double runningMax=0.0;
+            for(std::size_t j=0; j<cdf.size(); ++j){
+                runningMax=std::max(runningMax, std::min(cdf[j], 1.0));
+                if(cdfValues.empty()||runningMax>cdfValues.back()){
+                    cdfValues.push_back(runningMax);
+                    xValues.push_back(xMin+j*dx);
+                }
+            }
+            computeSlopes();
+            stats.endSolver(start, 0.0);
+        }
+        /**monotone cubic Hermite slopes of x against the CDF*/
+        void computeSlopes(){
+            const std::size_t n=cdfValues.size();
+            slopes.assign(n, 0.0);
+            if(n<2){
+                return;
+            }
+            std::vector<double> secants(n-1);
+            for(std::size_t j=0; j+1<n; ++j){
+                secants[j]=(xValues[j+1]-xValues[j])/(cdfValues[j+1]-cdfValues[j]);
+            }
+            slopes[0]=secants[0];
+            slopes[n-1]=secants[n-2];
+            for(std::size_t j=1; j+1<n; ++j){
+                slopes[j]=.5*(secants[j-1]+secants[j]);
+            }
+            for(std::size_t j=0; j+1<n; ++j){
+                const double a=slopes[j]/secants[j];
+                const double b=slopes[j+1]/secants[j];
+                const double radius=a*a+b*b;
+                if(radius>9.0){
+                    const double tau=3.0/sqrt(radius);
+                    slopes[j]=tau*a*secants[j];
+                    slopes[j+1]=tau*b*secants[j];
+                }
+            }
+        }
+        double xMin;
+        double xMax;
+        std::vector<double> discreteCF;
+        std::vector<double> cdfValues;
+        std::vector<double> xValues;
+        std::vector<double> slopes;
+    };
+
+    /**
+        Fraction of the domain used as the half width of the first warm 
+        started bracket, before the root has moved between two calls
+    */
+    constexpr double warmStartWidth=.001;
+
+    /**
+        VaR and ES for a sequence of slightly different distributions, such
+        as a daily time series or a parameter sweep.  The solver remembers 
+        the last root for every alpha and how far it moved on the previous
+        call, and the next solve starts from a bracket of that half width 
+        around the last root which is expanded until it holds the root.  
+        The first solve for an alpha uses options as computeVaR would, so 
+        with a BatchCF the cumulant bracket needs the cumulants passed in.  
+        Not safe to share between threads.
+    */
+    class VaRSolver{
+    public:
+        explicit VaRSolver(const double& prec_, const SolverOptions& options_=SolverOptions()):
+            prec(prec_),
+            options(options_){}
+
+        template<typename CFDiscrete>
+        double varDiscrete(const double& alpha, const double& xMin, const double& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+            return -solve(alpha, xMin, xMax, discreteCF, options, stats).x;
+        }
+        template<typename CFDiscrete>
+        double varDiscrete(const double& alpha, const double& xMin, const double& xMax, CFDiscrete&& discreteCF){
+            NoStats stats;
+            return -solve(alpha, xMin, xMax, discreteCF, options, stats).x;
+        }
+        template<typename CF, typename Index>
+        double var(const double& alpha, const double& xMin, const double& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+            const auto solveOptions=isWarm(alpha)?options:addCumulants(options, cf, stats);
+            return -solve(alpha, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), solveOptions, stats).x;
+        }
+        template<typename CF, typename Index>
+        double var(const double& alpha, const double& xMin, const double& xMax, const Index& numU, CF&& cf){
+            NoStats stats;
+            const auto solveOptions=isWarm(alpha)?options:addCumulants(options, cf, stats);
+            return -solve(alpha, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, cf), solveOptions, stats).x;
+        }
+
+        /**returns tuple of ES and VaR, as computeESDiscrete*/
+        template<typename CFDiscrete>
+        auto esDiscrete(const double& alpha, const double& xMin, const double& xMax, CFDiscrete&& discreteCF, SolverStats& stats){
+            return toES(alpha, solve(alpha, xMin, xMax, discreteCF, options, stats));
+        }
+        template<typename CFDiscrete>
+        auto esDiscrete(const double& alpha, const double& xMin, const double& xMax, CFDiscrete&& discreteCF){
+            NoStats stats;
+            return toES(alpha, solve(alpha, xMin, xMax, discreteCF, options, stats));
+        }
+        template<typename CF, typename Index>
+        auto es(const double& alpha, const double& xMin, const double& xMax, const Index& numU, CF&& cf, SolverStats& stats){
+            const auto solveOptions=isWarm(alpha)?options:addCumulants(options, cf, stats);
+            return toES(alpha, solve(alpha, xMin, xMax, computeDiscreteCFWithStats(xMin, xMax, numU, cf, stats), solveOptions, stats));
+        }
+        template<typename CF, typename Index>
+        auto es(const double& alpha, const double& xMin, const double& xMax, const Index& numU, CF&& cf){
+            NoStats stats;
+            const auto solveOptions=isWarm(alpha)?options:addCumulants(options, cf, stats);
+            return toES(alpha, solve(alpha, xMin, xMax, computeDiscreteCF(xMin, xMax, numU, cf), solveOptions, stats));
+        }
+
+        /**forgets every root, so the next solves start cold*/
+        void reset(){
+            warmStarts.clear();
+        }
+    private:
+        struct WarmStart{
+            double x;
+            double width;
+        };
+        bool isWarm(const double& alpha) const{
+            return warmStarts.find(alpha)!=warmStarts.end();
+        }
+        template<typename CFDiscrete, typename Stats>
+        CDFRoot<double> solve(const double& alpha, const double& xMin, const double& xMax, const CFDiscrete& discreteCF, const SolverOptions& solveOptions, Stats& stats){
+            const auto warmStart=warmStarts.find(alpha);
+            if(warmStart==warmStarts.end()){
+                const auto root=solveCDF(alpha, xMin, xMax, xMin, xMax, discreteCF, prec, prec, solveOptions, stats);
+                warmStarts.emplace(alpha, WarmStart{root.x, warmStartWidth*(xMax-xMin)});
+                return root;
+            }
+            const auto root=solveCDFFromGuess(alpha, xMin, xMax, xMin, xMax, warmStart->second.x, warmStart->second.width, discreteCF, prec, prec, solveOptions.method, stats);
+            warmStart->second=WarmStart{root.x, std::abs(root.x-warmStart->second.x)};
+            return root;
+        }
+        static std::tuple<double, double> toES(const double& alpha, const CDFRoot<double>& root){
+            return std::make_tuple(-root.evaluation.expectation/alpha, -root.x);
+        }
+        double prec;
+        SolverOptions options;
+        std::map<double, WarmStart> warmStarts;
+    };
 
 }
 
@@ -0,0 +1,61 @@
+#ifndef __SV3_H_INCLUDED__
+#define __SV3_H_INCLUDED__
+#include <cmath>
+#include "CharacteristicFunctions.h"
+/**NOTE That this is to test distributions for the option dashboard.  See issue
+ * https://github.com/phillyfan1138/levy-functions/issues/27
+ * 
+ * */
+inline auto cfLogBase(
+    double T
+){
+    return [=](
+        const auto& u,
+        double lambda, 
+        double muJ, double sigJ,
+        double sigma, double v0, 
+        double speed,double adaV, 
+        double rho
+    ){
+        
+        return chfunctions::cirLogMGF(
+            -chfunctions::mertonLogRNCF(u, lambda, muJ, sigJ, 0.0, sigma),
+            speed, 
+            speed-adaV*rho*u*sigma,
+            adaV,
+            T,
+            v0
+        );
+        
+    };
+}
+
+inline auto cf(
+    double r,
+    double T
+){
+    //trivially copyable...this is the SV3 of the following paper:
+    //https://pdfs.semanticscholar.org/67cd/b553e2624c79a960ff79d0dfe6e6833690a7.pdf 
+    return [=](
+        double lambda,
+        double muJ, 
+        double sigJ,
+        double sigma,
+        double v0,
+        double speed,
+        double adaV,
+        double rho
+    ){
+        auto cfLogTmp=cfLogBase(T);
+        return [=, cfLog=std::move(cfLogTmp)](const auto& u){
+            return exp(r*T*u+
+                cfLog(u, lambda, muJ, sigJ, sigma, v0, speed, adaV, rho)
+            );
+        };
+    };
+}
+inline auto get_jump_diffusion_vol(double sigma, double lambda, double muJ, double sigJ, double T){
+    return sqrt((sigma*sigma+lambda*(muJ*muJ+sigJ*sigJ))*T);
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <complex>
+#include <cstdlib>
+#include <algorithm>
+#include "FangOost.h"
+#include "CFDistUtilities.h"
+#include "SV3.h"
+
+/**
+ * Times every public entry point, and lookups in a QuantileTable, for the
+ * normal CF and the SV3 CF of test.cpp over numU=64..4096 and writes the
+ * results as JSON, one result per line.  Usage:
+ *   ./bench > baseline.json
+ *   ./bench --baseline baseline.json [--tolerance .25]
+ * With a baseline, every result also holds the baseline time and their
+ * ratio, results slower than the baseline by more than the tolerance are
+ * flagged as regressions, and the exit code is 1 if there are any.
+ * The computeVaR results for each bracketing method, with and without the
+ * cumulant bracket, and the warm started VaRSolver over a series of shifted
+ * distributions also hold the number of solver iterations.
+ * The pointSums results compare sin and cos for every term with the 
+ * rotation recurrence and the SIMD kernel, and the gridSums results time 
+ * the point kernel and the transform on the same grid of numX points.
+ * */
+struct BenchResult{
+    std::string name;
+    std::string cf;
+    int numU;
+    double nanoseconds;
+    long iterations=-1;
+};
+
+/**
+ * Nanoseconds per call.  Each of numSamples samples repeats fn until 
+ * sampleSeconds has passed (and at least minRepeat times), so that fast and
+ * slow entry points are both timed reliably, and the fastest sample is 
+ * kept since noise only ever adds time.
+ * */
+template<typename Fn>
+double timeNanoseconds(Fn&& fn, int numSamples=5, double sampleSeconds=.01, int minRepeat=2){
+    double best=0.0;
+    int numCalls=0;
+    for(int sample=0; sample<numSamples; ++sample){
+        int numRepeat=0;
+        const auto start=std::chrono::steady_clock::now();
+        auto end=start;
+        while(numRepeat<minRepeat||std::chrono::duration<double>(end-start).count()<sampleSeconds){
+            fn(numCalls++);
+            ++numRepeat;
+            end=std::chrono::steady_clock::now();
+        }
+        const double nanoseconds=std::chrono::duration<double, std::nano>(end-start).count()/numRepeat;
+        best=sample==0?nanoseconds:std::min(best, nanoseconds);
+    }
+    return best;
+}
+
+template<typename CF>
+void benchEntryPoints(const std::string& cfName, const double& xMin, const double& xMax, CF&& cf, std::vector<BenchResult>& results){
+    const double alpha=.01;
+    const double prec=.0000001;
+    const int numX=1024;
+    volatile double sink=0;
+    for(int numU=64; numU<=4096; numU*=2){
+        const auto addResult=[&](const std::string& name, double nanoseconds){
+            results.push_back(BenchResult{name, cfName, numU, nanoseconds});
+        };
+        addResult("computeVaR", timeNanoseconds([&](const auto&){
+            sink=cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, cf);
+        }));
+        for(const bool cumulantBracket:{false, true})
+        for(const auto& method:{std::make_pair("bisection", cfdistutilities::RootMethod::bisection), std::make_pair("brent", cfdistutilities::RootMethod::brent), std::make_pair("itp", cfdistutilities::RootMethod::itp)}){
+            const cfdistutilities::SolverOptions options(method.second, cumulantBracket);
+            cfdistutilities::SolverStats stats;
+            cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, cf, options, stats);
+            results.push_back(BenchResult{std::string("computeVaR(")+method.first+(cumulantBracket?"+cumulantBracket)":")"), cfName, numU, timeNanoseconds([&](const auto&){
+                sink=cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, cf, options);
+            }), static_cast<long>(stats.iterations)});
+        }
+        //a daily series: the distribution shifts by a small step every call
+        for(const auto& method:{std::make_pair("bisection", cfdistutilities::RootMethod::bisection), std::make_pair("brent", cfdistutilities::RootMethod::brent)}){
+            cfdistutilities::VaRSolver solver(prec, cfdistutilities::SolverOptions(method.second));
+            const auto shiftedCF=[&](int day){
+                const double shift=.0001*(xMax-xMin)*(day%100);
+                return [&cf, shift](const auto& z){
+                    return cf(z)*exp(z*shift);
+                };
+            };
+            cfdistutilities::SolverStats stats;
+            solver.var(alpha, xMin, xMax, numU, shiftedCF(0));
+            solver.var(alpha, xMin, xMax, numU, shiftedCF(1));
+            solver.var(alpha, xMin, xMax, numU, shiftedCF(2), stats);
+            results.push_back(BenchResult{std::string("VaRSolver::var(")+method.first+")", cfName, numU, timeNanoseconds([&](const auto& i){
+                sink=solver.var(alpha, xMin, xMax, numU, shiftedCF(3+i));
+            }), static_cast<long>(stats.iterations)});
+        }
+        addResult("computeVaRNewton", timeNanoseconds([&](const auto&){
+            sink=cfdistutilities::computeVaRNewton(alpha, prec, prec, xMin, xMax, .5*(xMin+xMax), numU, cf);
+        }));
+        addResult("computeES", timeNanoseconds([&](const auto&){
+            sink=std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, xMin, xMax, numU, cf));
+        }));
+        addResult("computeEL", timeNanoseconds([&](const auto&){
+            sink=cfdistutilities::computeEL(xMin, xMax, numU, cf);
+        }));
+        addResult("computeCDF", timeNanoseconds([&](const auto& i){
+            sink=cfdistutilities::computeCDF(numX, numU, xMin, xMax, cf)[i%numX];
+        }));
+        addResult("computeCDFAtPoint", timeNanoseconds([&](const auto& i){
+            const double x=xMin+(xMax-xMin)*(i%97)/97.0;
+            sink=cfdistutilities::computeCDFAtPoint(x, numU, xMin, xMax, cf);
+        }));
+        //the point kernels: sin and cos for every term, the rotation
+        //recurrence, and the SIMD kernel on a contiguous view
+        const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, cf);
+        const auto pointX=[&](const auto& i){
+            return xMin+(xMax-xMin)*(i%97)/97.0;
+        };
+        addResult("pointSums(direct)", timeNanoseconds([&](const auto& i){
+            sink=fangoost::computeExpectationPointDiscrete(pointX(i), xMin, xMax, discreteCF, [&](const auto& u, const auto& x, const auto& index){
+                return cfdistutilities::VkCDF(u, x, xMin, xMax, index);
+            });
+        }));
+        addResult("pointSums(recurrence)", timeNanoseconds([&](const auto& i){
+            sink=cfdistutilities::computePointSums(pointX(i), xMin, xMax, discreteCF).cosine;
+        }));
+        addResult("pointSums(simd)", timeNanoseconds([&](const auto& i){
+            sink=cfdistutilities::computePointSums(pointX(i), xMin, xMax, cfdistutilities::viewOf(discreteCF)).cosine;
+        }));
+        //the two ways of computing GridSums that useGridTransform chooses
+        //between, each forced; their crossover bounds transformCostRatio
+        cfdistutilities::GridSums sums;
+        cfdistutilities::TransformWorkspace workspace;
+        addResult("gridSums(point)", timeNanoseconds([&](const auto& i){
+            const double dx=(xMax-xMin)/(numX-1);
+            sums.sinOverU.resize(numX);
+            sums.cosMinusOneOverUSquared.resize(numX);
+            for(int j=0; j<numX; ++j){
+                const auto pointSums=cfdistutilities::computePointSums(xMin+j*dx, xMin, xMax, cfdistutilities::viewOf(discreteCF));
+                sums.sinOverU[j]=pointSums.sinOverU;
+                sums.cosMinusOneOverUSquared[j]=pointSums.cosMinusOneOverUSquared;
+            }
+            sink=sums.sinOverU[i%numX];
+        }));
+        addResult("gridSums(transform)", timeNanoseconds([&](const auto& i){
+            cfdistutilities::computeGridSumsTransform(numX, xMin, xMax, cfdistutilities::viewOf(discreteCF), sums, workspace);
+            sink=sums.sinOverU[i%numX];
+        }));
+        const cfdistutilities::QuantileTable table(4097, numU, xMin, xMax, cf);
+        addResult("QuantileTable::quantile", timeNanoseconds([&](const auto& i){
+            sink=table.quantile((1+i%97)/98.0);
+        }));
+    }
+}
+
+std::string getKey(const BenchResult& result){
+    return result.name+"/"+result.cf+"/"+std::to_string(result.numU);
+}
+
+/**
+ * Reads a file written by this program.  Only its own one result per line
+ * format is understood.
+ * */
+std::vector<BenchResult> readResults(const std::string& fileName){
+    std::ifstream file(fileName);
+    std::vector<BenchResult> results;
+    std::string line;
+    const auto getField=[&](const std::string& field){
+        const auto position=line.find("\""+field+"\": ");
+        if(position==std::string::npos){
+            return std::string();
+        }
+        const auto start=position+field.size()+4;
+        if(start<line.size()&&line[start]=='"'){
+            //strings run to the closing quote, so names may hold commas
+            return line.substr(start+1, line.find('"', start+1)-start-1);
+        }
+        return line.substr(start, line.find_first_of(",}", start)-start);
+    };
+    while(std::getline(file, line)){
+        const auto name=getField("name");
+        if(!name.empty()){
+            results.push_back(BenchResult{name, getField("cf"), std::stoi(getField("numU")), std::stod(getField("nanoseconds"))});
+        }
+    }
+    return results;
+}
+
+int main(int argc, char* argv[]){
+    std::string baselineFile;
+    double tolerance=.25;
+    for(int i=1; i+1<argc; i+=2){
+        const std::string argument=argv[i];
+        if(argument=="--baseline"){
+            baselineFile=argv[i+1];
+        }
+        else if(argument=="--tolerance"){
+            tolerance=std::atof(argv[i+1]);
+        }
+    }
+    std::vector<BenchResult> results;
+
+    const double mu=2;
+    const double sigma=5;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    benchEntryPoints("normal", -20.0, 25.0, normCF, results);
+
+    const double r=.004;
+    const double sigmaSV3=.3183;
+    const double sigJ=.220094;
+    const double muJ=-.302967;
+    const double lambda=.204516;
+    const double speed=2.6726;
+    const double v0=.237187;
+    const double rho=-.182754;
+    const double T=.187689;
+    const double adaV=0;
+    const double xMax=get_jump_diffusion_vol(sigmaSV3, lambda, muJ, sigJ, T)*5.0;
+    benchEntryPoints("SV3", -xMax, xMax, cf(r, T)(lambda, muJ, sigJ, sigmaSV3, v0, speed, adaV, rho), results);
+
+    const auto baseline=baselineFile.empty()?std::vector<BenchResult>():readResults(baselineFile);
+    int numRegressions=0;
+    std::cout<<"{\"results\": ["<<std::endl;
+    for(std::size_t i=0; i<results.size(); ++i){
+        const auto& result=results[i];
+        std::ostringstream line;
+        line<<"{\"name\": \""<<result.name<<"\", \"cf\": \""<<result.cf<<"\", \"numU\": "<<result.numU<<", \"nanoseconds\": "<<result.nanoseconds;
+        if(result.iterations>=0){
+            line<<", \"iterations\": "<<result.iterations;
+        }
+        for(const auto& previous:baseline){
+            if(getKey(previous)==getKey(result)){
+                const double ratio=result.nanoseconds/previous.nanoseconds;
+                const bool isRegression=ratio>1.0+tolerance;
+                numRegressions+=isRegression;
+                line<<", \"baseline\": "<<previous.nanoseconds<<", \"ratio\": "<<ratio<<", \"regression\": "<<(isRegression?"true":"false");
+                if(isRegression){
+                    std::cerr<<"regression: "<<getKey(result)<<" "<<ratio<<" times baseline"<<std::endl;
+                }
+            }
+        }
+        line<<"}";
+        std::cout<<line.str()<<(i+1<results.size()?",":"")<<std::endl;
+    }
+    std::cout<<"]}"<<std::endl;
+    return numRegressions>0;
+}
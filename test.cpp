@@ -3,65 +3,54 @@
 #include "FunctionalUtilities.h"
 #include <iostream>
 #include "CFDistUtilities.h"
-#include "CharacteristicFunctions.h"
+#include "SV3.h"
 #include "FangOost.h"
 #include <complex>
+#include <deque>
+#include <new>
+#include <cstdlib>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
 
-/**NOTE That this is to test distributions for the option dashboard.  See issue
- * https://github.com/phillyfan1138/levy-functions/issues/27
- * 
- * */
-auto cfLogBase(
-    double T
-){
-    return [=](
-        const auto& u,
-        double lambda, 
-        double muJ, double sigJ,
-        double sigma, double v0, 
-        double speed,double adaV, 
-        double rho
-    ){
-        
-        return chfunctions::cirLogMGF(
-            -chfunctions::mertonLogRNCF(u, lambda, muJ, sigJ, 0.0, sigma),
-            speed, 
-            speed-adaV*rho*u*sigma,
-            adaV,
-            T,
-            v0
-        );
-        
-    };
+/**
+    Counts heap allocations so that tests can check that a call makes none.
+    Every form of new and delete is replaced so that they stay paired.  The
+    release is kept out of line since GCC otherwise sees free called on the
+    result of operator new wherever a delete is inlined.
+*/
+std::atomic<std::size_t> numAllocations(0);
+#ifdef __GNUC__
+    #define TEST_NOINLINE __attribute__((noinline))
+#else
+    #define TEST_NOINLINE
+#endif
+TEST_NOINLINE void releaseAllocation(void* pointer) noexcept{
+    std::free(pointer);
 }
-
-auto cf(
-    double r,
-    double T
-){
-    //trivially copyable...this is the SV3 of the following paper:
-    //https://pdfs.semanticscholar.org/67cd/b553e2624c79a960ff79d0dfe6e6833690a7.pdf 
-    return [=](
-        double lambda,
-        double muJ, 
-        double sigJ,
-        double sigma,
-        double v0,
-        double speed,
-        double adaV,
-        double rho
-    ){
-        auto cfLogTmp=cfLogBase(T);
-        return [=, cfLog=std::move(cfLogTmp)](const auto& u){
-            return exp(r*T*u+
-                cfLog(u, lambda, muJ, sigJ, sigma, v0, speed, adaV, rho)
-            );
-        };
-    };
+void* operator new(std::size_t size){
+    ++numAllocations;
+    if(void* pointer=std::malloc(size>0?size:1)){
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+void operator delete(void* pointer) noexcept{
+    releaseAllocation(pointer);
+}
+void operator delete(void* pointer, std::size_t) noexcept{
+    releaseAllocation(pointer);
+}
+void operator delete[](void* pointer) noexcept{
+    releaseAllocation(pointer);
 }
-auto get_jump_diffusion_vol(double sigma, double lambda, double muJ, double sigJ, double T){
-    return sqrt((sigma*sigma+lambda*(muJ*muJ+sigJ*sigJ))*T);
+void operator delete[](void* pointer, std::size_t) noexcept{
+    releaseAllocation(pointer);
 }
+
 /**
 Compile your application with -g, then you'll have debug symbols in the binary file.
 Use gdb to open the gdb console.
@@ -125,6 +114,22 @@ TEST_CASE("Test computeVaRNewton", "[CFDistUtilities]"){
     auto myqNorm=cfdistutilities::computeVaRNewton(alpha, prec, prec, xMin, xMax, mu, numU, normCF);
     REQUIRE(myqNorm==Approx(qnormReference));
 } 
+TEST_CASE("Test computeVaRNewton where the density vanishes", "[CFDistUtilities]"){
+    const double xMin=-2;
+    const double xMax=20;
+    const int numU=256;
+    const double alpha=.05;
+    auto expCF=[&](const auto& u){ //exponential distribution's CF, no density below zero
+        return 1.0/(1.0-u);
+    };
+    double prec=.0000001;
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, expCF);
+    const double guess=-1.8;
+    REQUIRE(std::get<1>(cfdistutilities::computeCDFAndPDFAtPoint(guess, xMin, xMax, discreteCF))<=0.0);
+    const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    REQUIRE(cfdistutilities::computeVaRNewtonDiscrete(alpha, prec, prec, xMin, xMax, guess, discreteCF)==Approx(VaR));
+    REQUIRE(cfdistutilities::computeVaRNewton(alpha, prec, prec, xMin, xMax, guess, numU, expCF)==Approx(VaR));
+}
 TEST_CASE("Test cdf", "[CFDistUtilities]"){
     const double mu=2;
     const double sigma=5;
@@ -223,4 +228,911 @@ TEST_CASE("Test computeEL", "[CFDistUtilities]"){
     };      
     auto myqNorm=cfdistutilities::computeEL( xMin, xMax, numU, normCF);
     REQUIRE(myqNorm==Approx(mu)); 
-} 
\ No newline at end of file
+}
+TEST_CASE("Test computeVaRBatch", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=64;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const std::vector<double> alphas={.05, .001, .1, .01, .025, .005};
+    double prec=.0000001;
+    auto myVaRs=cfdistutilities::computeVaRBatch(alphas, prec, xMin, xMax, numU, normCF);
+    REQUIRE(myVaRs.size()==alphas.size());
+    for(std::size_t i=0; i<alphas.size(); ++i){
+        REQUIRE(myVaRs[i]==Approx(cfdistutilities::computeVaR(alphas[i], prec, xMin, xMax, numU, normCF)));
+    }
+    REQUIRE(myVaRs[0]==Approx(6.224268));
+    //sorted, each root bounds the next alpha from below and earlier evaluations from above
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    for(const double batchPrec:{prec, 1e-10}){
+        cfdistutilities::SolverStats batchStats;
+        const auto batchVaRs=cfdistutilities::computeVaRBatchDiscrete(alphas, batchPrec, xMin, xMax, discreteCF, batchStats);
+        std::size_t separateEvaluations=0;
+        for(std::size_t i=0; i<alphas.size(); ++i){
+            cfdistutilities::SolverStats stats;
+            REQUIRE(batchVaRs[i]==Approx(cfdistutilities::computeVaRDiscrete(alphas[i], batchPrec, xMin, xMax, discreteCF, stats)));
+            separateEvaluations+=stats.iterations;
+        }
+        REQUIRE(batchStats.iterations+alphas.size()<separateEvaluations);
+    }
+    //a repeated alpha takes the root of the first
+    const auto repeatedVaRs=cfdistutilities::computeVaRBatchDiscrete(std::vector<double>({.05, .01, .05}), prec, xMin, xMax, discreteCF);
+    REQUIRE(repeatedVaRs[0]==repeatedVaRs[2]);
+    REQUIRE(repeatedVaRs[1]==Approx(myVaRs[3]));
+} 
+TEST_CASE("Test computeVaRNewtonBisect", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=64;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto qnormReference=6.224268;
+    double prec=.0000001;
+    auto myqNorm=cfdistutilities::computeVaRNewtonBisect(alpha, prec, prec, xMin, xMax, mu, numU, normCF);
+    REQUIRE(myqNorm==Approx(qnormReference));
+} 
+TEST_CASE("Test computeVaRNewtonBisect wide domain", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=1024;
+    const double xMin=-400;
+    const double xMax=400;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto qnormReference=6.224268;
+    double prec=.0000001;
+    //a guess in the flat tail, where plain Newton overshoots the domain
+    auto myqNorm=cfdistutilities::computeVaRNewtonBisect(alpha, prec, prec, xMin, xMax, xMin+1.0, numU, normCF);
+    REQUIRE(myqNorm==Approx(qnormReference));
+} 
+TEST_CASE("Test cdf and pdf point", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=64;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto pnormReference=.6554217; 
+    const auto dnormReference=.07365403;
+    const auto actualResult=cfdistutilities::computeCDFAndPDFAtPoint(4.0, xMin, xMax, fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF));
+    REQUIRE(std::get<0>(actualResult)==Approx(pnormReference));
+    REQUIRE(std::get<1>(actualResult)==Approx(dnormReference));
+} 
+TEST_CASE("Test evaluatePoint matches direct summation", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=1024;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    for(const auto& x:{-19.5, -3.3, 4.0, 11.7, 24.9}){
+        const auto evaluation=cfdistutilities::evaluatePoint(x, xMin, xMax, discreteCF);
+        const auto cdf=fangoost::computeExpectationPointDiscrete(x, xMin, xMax, discreteCF, [&](const auto& u, const auto& xValue, const auto& index){
+            return cfdistutilities::VkCDF(u, xValue, xMin, xMax, index);
+        });
+        const auto expectation=fangoost::computeExpectationPointDiscrete(x, xMin, xMax, discreteCF, [&](const auto& u, const auto& xValue, const auto& index){
+            return cfdistutilities::VkE(u, xValue, xMin, xMax, index);
+        });
+        REQUIRE(std::abs(evaluation.cdf-cdf)<1e-12);
+        REQUIRE(std::abs(evaluation.expectation-expectation)<1e-11);
+    }
+} 
+TEST_CASE("Test vectorized kernel matches generic path", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=203;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    //a non contiguous container takes the generic path
+    const std::deque<double> discreteCFDeque(discreteCF.begin(), discreteCF.end());
+    for(const auto& x:{-19.5, -3.3, 4.0, 11.7, 24.9}){
+        const auto kernel=cfdistutilities::evaluatePoint(x, xMin, xMax, discreteCF);
+        const auto generic=cfdistutilities::evaluatePoint(x, xMin, xMax, discreteCFDeque);
+        REQUIRE(std::abs(kernel.cdf-generic.cdf)<1e-13);
+        REQUIRE(std::abs(kernel.pdf-generic.pdf)<1e-13);
+        REQUIRE(std::abs(kernel.expectation-generic.expectation)<1e-12);
+    }
+} 
+TEST_CASE("Test cdf transform matches point evaluation", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=1024;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    //one power of two and one Bluestein length
+    for(const int xDiscrete:{513, 301}){
+        REQUIRE(cfdistutilities::useGridTransform(xDiscrete, numU));
+        const auto cdf=cfdistutilities::computeCDF(xDiscrete, xMin, xMax, discreteCF);
+        const auto expectation=cfdistutilities::computePartialExpectation(xDiscrete, xMin, xMax, discreteCF);
+        const double dx=(xMax-xMin)/(xDiscrete-1);
+        for(int j=0; j<xDiscrete; ++j){
+            const auto evaluation=cfdistutilities::evaluatePoint(xMin+j*dx, xMin, xMax, discreteCF);
+            REQUIRE(std::abs(cdf[j]-evaluation.cdf)<1e-12);
+            REQUIRE(std::abs(expectation[j]-evaluation.expectation)<1e-11);
+        }
+        REQUIRE(expectation.back()==Approx(mu));
+    }
+} 
+TEST_CASE("Test parallel cdf is identical to serial", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=64;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    //the first is evaluated point by point, the second by transform
+    for(const int xDiscrete:{46, 1025}){
+        const auto cdf=cfdistutilities::computeCDF(xDiscrete, numU, xMin, xMax, normCF);
+        const auto cdfParallel=cfdistutilities::computeCDF(cfdistutilities::ParallelPolicy{4}, xDiscrete, numU, xMin, xMax, normCF);
+        const auto expectation=cfdistutilities::computePartialExpectation(xDiscrete, numU, xMin, xMax, normCF);
+        const auto expectationParallel=cfdistutilities::computePartialExpectation(cfdistutilities::par, xDiscrete, numU, xMin, xMax, normCF);
+        REQUIRE(cdf==cdfParallel);
+        REQUIRE(expectation==expectationParallel);
+    }
+    //transforms large enough to split the FFT stages, radix-2 and Bluestein
+    for(const int xDiscrete:{4097, 5000}){
+        const int largeNumU=1024;
+        REQUIRE(cfdistutilities::useGridTransform(xDiscrete, largeNumU));
+        const auto cdf=cfdistutilities::computeCDF(xDiscrete, largeNumU, xMin, xMax, normCF);
+        const auto cdfParallel=cfdistutilities::computeCDF(cfdistutilities::ParallelPolicy{4}, xDiscrete, largeNumU, xMin, xMax, normCF);
+        REQUIRE(cdf==cdfParallel);
+    }
+} 
+TEST_CASE("Test adaptive numU", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    int numCFCalls=0;
+    auto countedCF=[&](const auto& u){
+        ++numCFCalls;
+        return normCF(u);
+    };
+    const cfdistutilities::AdaptiveNumU adaptive(1e-12);
+    const auto discreteCF=cfdistutilities::computeDiscreteCFAdaptive(xMin, xMax, adaptive, countedCF);
+    //each term evaluated once
+    REQUIRE(numCFCalls==static_cast<int>(discreteCF.size()));
+    //the normal's coefficients decay quickly so far fewer than maxNumU terms are needed
+    REQUIRE(discreteCF.size()<=64);
+    const auto reference=fangoost::computeDiscreteCFReal(xMin, xMax, static_cast<int>(discreteCF.size()), normCF);
+    for(std::size_t k=0; k<discreteCF.size(); ++k){
+        REQUIRE(discreteCF[k]==Approx(reference[k]));
+    }
+    const auto qnormReference=6.224268;
+    double prec=.0000001;
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, adaptive, normCF)==Approx(qnormReference));
+    cfdistutilities::SolverStats stats;
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, adaptive, normCF, stats)==Approx(qnormReference));
+    REQUIRE(stats.numCoefficients==discreteCF.size());
+    const auto pnormReference=.6554217; 
+    REQUIRE(cfdistutilities::computeCDF(46, adaptive, xMin, xMax, normCF)[24]==Approx(pnormReference));
+    //the entry points without stats report the numU chosen through reportingTo
+    std::size_t chosenNumU=0;
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, adaptive.reportingTo(&chosenNumU), normCF)==Approx(qnormReference));
+    REQUIRE(chosenNumU==discreteCF.size());
+    chosenNumU=0;
+    REQUIRE(std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, xMin, xMax, adaptive.reportingTo(&chosenNumU), normCF))==Approx(8.313564).epsilon(.0001));
+    REQUIRE(chosenNumU==discreteCF.size());
+    REQUIRE(adaptive.chosenNumU==nullptr);
+    //the workspace overloads take AdaptiveNumU, and the view has the numU chosen
+    cfdistutilities::Workspace workspace;
+    chosenNumU=0;
+    const auto workspaceCF=cfdistutilities::computeDiscreteCF(workspace, xMin, xMax, adaptive.reportingTo(&chosenNumU), normCF);
+    REQUIRE(workspaceCF.size()==discreteCF.size());
+    REQUIRE(chosenNumU==discreteCF.size());
+    for(std::size_t k=0; k<discreteCF.size(); ++k){
+        REQUIRE(std::abs(workspaceCF[k]-discreteCF[k])<1e-14);
+    }
+    const auto expectedCDF=cfdistutilities::computeCDF(46, adaptive, xMin, xMax, normCF);
+    cfdistutilities::computeCDF(workspace, 46, adaptive, xMin, xMax, normCF);
+    const auto numAllocationsBefore=numAllocations.load();
+    const auto& workspaceCDF=cfdistutilities::computeCDF(workspace, 46, adaptive, xMin, xMax, normCF);
+    const auto& workspaceExpectation=cfdistutilities::computePartialExpectation(workspace, 46, adaptive, xMin, xMax, normCF);
+    const auto numAllocationsAfter=numAllocations.load();
+    REQUIRE(numAllocationsAfter==numAllocationsBefore);
+    REQUIRE(workspaceExpectation.back()==Approx(mu));
+    cfdistutilities::computeCDF(workspace, 46, adaptive, xMin, xMax, normCF);
+    for(std::size_t i=0; i<expectedCDF.size(); ++i){
+        REQUIRE(std::abs(workspaceCDF[i]-expectedCDF[i])<1e-12);
+    }
+} 
+TEST_CASE("Test cumulants and automatic domain", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    const auto cumulants=cfdistutilities::computeCumulants(normCF);
+    REQUIRE(cumulants[0]==Approx(mu));
+    REQUIRE(cumulants[1]==Approx(sigma*sigma));
+    REQUIRE(std::abs(cumulants[2])<1e-8);
+    REQUIRE(std::abs(cumulants[3])<1e-8);
+    const auto domain=cfdistutilities::computeDomain(cfdistutilities::autoDomain, normCF);
+    REQUIRE(domain.first==Approx(mu-10.0*sigma));
+    REQUIRE(domain.second==Approx(mu+10.0*sigma));
+    const auto qnormReference=6.224268;
+    double prec=.0000001;
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, cfdistutilities::autoDomain, numU, normCF)==Approx(qnormReference));
+    REQUIRE(cfdistutilities::computeEL(cfdistutilities::autoDomain, numU, normCF)==Approx(mu));
+} 
+TEST_CASE("Test automatic domain Difficult Distribution", "[CFDistUtilities]"){
+    const int numU=256;
+    const double alpha=.01;
+    const double r=.004;
+    const double sigma=.3183;
+    const double sigJ=.220094;
+    const double muJ=-.302967;
+    const double lambda=.204516;
+    const double speed=2.6726;
+    const double v0=.237187;
+    const double rho=-.182754;
+    const double T=.187689;
+    const double adaV=0;
+    const double xMax=get_jump_diffusion_vol(sigma, lambda, muJ, sigJ, T)*5.0;
+    const double xMin=-xMax;
+    auto cfInst=cf(r, T)(lambda, muJ, sigJ, sigma, v0, speed, adaV, rho);
+    double prec=.0000001;
+    const auto cumulants=cfdistutilities::computeCumulants(cfInst);
+    //the CF is risk neutral, so E[exp(X)]=exp(rT)
+    const auto mgfAtOne=exp(cumulants[0]+cumulants[1]/2.0+cumulants[2]/6.0+cumulants[3]/24.0);
+    REQUIRE(mgfAtOne==Approx(exp(r*T)).epsilon(.01));
+    auto myq=cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, cfInst);
+    auto myqAuto=cfdistutilities::computeVaR(alpha, prec, cfdistutilities::AutoDomain(8.0), numU, cfInst);
+    REQUIRE(myqAuto==Approx(myq).epsilon(.001));
+    auto myES=cfdistutilities::computeES(alpha, prec, cfdistutilities::AutoDomain(8.0), numU, cfInst);
+    REQUIRE(std::get<cfdistutilities::VAR>(myES)==Approx(myqAuto));
+} 
+TEST_CASE("Test fused ES matches separate expectation pass", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=64;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    double prec=.0000000001;
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    const auto esAndVaR=cfdistutilities::computeESDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    const auto VaR=std::get<cfdistutilities::VAR>(esAndVaR);
+    REQUIRE(VaR==cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF));
+    const auto separateES=-fangoost::computeExpectationPointDiscrete(-VaR, xMin, xMax, discreteCF, [&](const auto& u, const auto& x, const auto& index){
+        return cfdistutilities::VkE(u, x, xMin, xMax, index);
+    })/alpha;
+    REQUIRE(std::abs(std::get<cfdistutilities::ES>(esAndVaR)-separateES)<1e-10);
+} 
+TEST_CASE("Test discrete entry points do not allocate", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };      
+    double prec=.0000001;
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    const cfdistutilities::DiscreteCFView<double> view(discreteCF.data(), discreteCF.size());
+    const auto numAllocationsBefore=numAllocations.load();
+    const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, view);
+    const auto esAndVaR=cfdistutilities::computeESDiscrete(alpha, prec, xMin, xMax, view);
+    const auto EL=cfdistutilities::computeELDiscrete(xMin, xMax, view);
+    const auto cdf=cfdistutilities::computeCDFAtPoint(4.0, xMin, xMax, view);
+    const auto VaRFromVector=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    const auto numAllocationsAfter=numAllocations.load();
+    REQUIRE(numAllocationsAfter==numAllocationsBefore);
+    REQUIRE(VaR==Approx(6.224268));
+    REQUIRE(VaRFromVector==VaR);
+    REQUIRE(std::get<cfdistutilities::ES>(esAndVaR)==Approx(8.313564).epsilon(.0001));
+    REQUIRE(EL==Approx(mu));
+    REQUIRE(cdf==Approx(.6554217));
+} 
+TEST_CASE("Test workspace computeCDF does not allocate after first call", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    cfdistutilities::Workspace workspace;
+    for(const int numX:{33, 4097}){
+        const auto expected=cfdistutilities::computeCDF(numX, numU, xMin, xMax, normCF);
+        const auto expectedExpectation=cfdistutilities::computePartialExpectation(numX, numU, xMin, xMax, normCF);
+        std::vector<double> buffer(numX);
+        std::vector<double> partialExpectation(numX);
+        cfdistutilities::computeCDF(workspace, numX, numU, xMin, xMax, normCF);
+        cfdistutilities::computePartialExpectation(workspace, numX, numU, xMin, xMax, normCF);
+        const auto numAllocationsBefore=numAllocations.load();
+        const auto end=cfdistutilities::computeCDF(workspace, numX, xMin, xMax, workspace.discreteCF, buffer.data());
+        const auto& expectation=cfdistutilities::computePartialExpectation(workspace, numX, numU, xMin, xMax, normCF);
+        std::copy(expectation.begin(), expectation.end(), partialExpectation.begin());
+        const auto& cdf=cfdistutilities::computeCDF(workspace, numX, numU, xMin, xMax, normCF);
+        const auto numAllocationsAfter=numAllocations.load();
+        REQUIRE(numAllocationsAfter==numAllocationsBefore);
+        REQUIRE(end==buffer.data()+numX);
+        for(int i=0; i<numX; ++i){
+            REQUIRE(std::abs(cdf[i]-expected[i])<1e-12);
+            REQUIRE(buffer[i]==cdf[i]);
+            REQUIRE(std::abs(partialExpectation[i]-expectedExpectation[i])<1e-11);
+        }
+    }
+}
+TEST_CASE("Test portfolio CF against product of loan CFs", "[CFDistUtilities]"){
+    std::vector<cfdistutilities::Loan> loans;
+    for(int i=0; i<3000; ++i){
+        loans.push_back(cfdistutilities::Loan{1.0+(i%17)*.5, .005+(i%7)*.004, .2+(i%5)*.15});
+    }
+    auto portfolioCF=[&](const auto& u){
+        std::complex<double> result(1.0, 0.0);
+        for(const auto& loan:loans){
+            result*=1.0-loan.pd+loan.pd*exp(-u*loan.exposure*loan.lgd);
+        }
+        return result;
+    };
+    const int numU=256;
+    const auto cumulants=cfdistutilities::computePortfolioCumulants(loans);
+    const auto numericCumulants=cfdistutilities::computeCumulants(portfolioCF);
+    for(int i=0; i<4; ++i){
+        REQUIRE(cumulants[i]==Approx(numericCumulants[i]).epsilon(.0001));
+    }
+    const auto xRange=cfdistutilities::computePortfolioDomain(cfdistutilities::autoDomain, loans);
+    const double xMin=xRange.first;
+    const double xMax=xRange.second;
+    const auto discreteCF=cfdistutilities::computePortfolioDiscreteCF(loans, xMin, xMax, numU);
+    const auto expectedCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, portfolioCF);
+    for(int k=0; k<numU; ++k){
+        REQUIRE(std::abs(discreteCF[k]-expectedCF[k])<1e-10);
+    }
+    //each thread accumulates its own block of loans, added in thread order
+    const auto parallelCF=cfdistutilities::computePortfolioDiscreteCF(cfdistutilities::ParallelPolicy{4}, loans, xMin, xMax, numU);
+    REQUIRE(parallelCF==cfdistutilities::computePortfolioDiscreteCF(cfdistutilities::ParallelPolicy{4}, loans, xMin, xMax, numU));
+    for(int k=0; k<numU; ++k){
+        REQUIRE(std::abs(parallelCF[k]-discreteCF[k])<1e-14);
+    }
+    const double alpha=.01;
+    const double prec=.0000001;
+    const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    const auto expectedVaR=cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, portfolioCF);
+    REQUIRE(VaR==Approx(expectedVaR));
+    const auto ES=cfdistutilities::computeESDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    REQUIRE(std::get<cfdistutilities::ES>(ES)>VaR);
+    REQUIRE(cfdistutilities::computeELDiscrete(xMin, xMax, discreteCF)==Approx(cumulants[0]).epsilon(.001));
+}
+TEST_CASE("Test incremental portfolio matches rebuilt portfolio", "[CFDistUtilities]"){
+    std::vector<cfdistutilities::Loan> loans;
+    for(int i=0; i<3000; ++i){
+        loans.push_back(cfdistutilities::Loan{1.0+(i%17)*.5, .005+(i%7)*.004, .2+(i%5)*.15});
+    }
+    const cfdistutilities::Loan extraLoan{40.0, .02, .5};
+    const int numU=256;
+    const double alpha=.01;
+    const auto xRange=cfdistutilities::computePortfolioDomain(cfdistutilities::AutoDomain(12.0), loans);
+    cfdistutilities::IncrementalPortfolio portfolio(loans, xRange.first, xRange.second, numU);
+    const auto VaR=portfolio.var(alpha);
+    const auto ES=portfolio.es(alpha);
+    REQUIRE(VaR==Approx(cfdistutilities::computeVaRDiscrete(alpha, .0000001, xRange.first, xRange.second, cfdistutilities::computePortfolioDiscreteCF(loans, xRange.first, xRange.second, numU))));
+    portfolio.add(extraLoan);
+    auto withExtraLoan=loans;
+    withExtraLoan.push_back(extraLoan);
+    const auto rebuiltCF=cfdistutilities::computePortfolioDiscreteCF(withExtraLoan, xRange.first, xRange.second, numU);
+    const auto& discreteCF=portfolio.getDiscreteCF();
+    for(int k=0; k<numU; ++k){
+        REQUIRE(std::abs(discreteCF[k]-rebuiltCF[k])<1e-12);
+    }
+    REQUIRE(portfolio.var(alpha)>VaR);
+    REQUIRE(portfolio.var(alpha)==Approx(cfdistutilities::computeVaRDiscrete(alpha, .0000001, xRange.first, xRange.second, rebuiltCF)));
+    portfolio.remove(extraLoan);
+    REQUIRE(portfolio.var(alpha)==Approx(VaR));
+    REQUIRE(portfolio.es(alpha)==Approx(ES));
+}
+TEST_CASE("Test bucketed portfolio", "[CFDistUtilities]"){
+    std::vector<cfdistutilities::Loan> loans;
+    for(int i=0; i<5000; ++i){
+        loans.push_back(cfdistutilities::Loan{1.0+(i%17)*.5+(i%3)*.001, .005+(i%7)*.004, .2+(i%5)*.15});
+    }
+    const int numU=256;
+    const double alpha=.01;
+    const double prec=.0000001;
+    const auto xRange=cfdistutilities::computePortfolioDomain(cfdistutilities::autoDomain, loans);
+    const auto exactBuckets=cfdistutilities::bucketLoans(loans);
+    REQUIRE(exactBuckets.size()==17*3*7*5);
+    const auto cumulants=cfdistutilities::computePortfolioCumulants(loans);
+    const auto bucketCumulants=cfdistutilities::computePortfolioCumulants(exactBuckets);
+    for(int i=0; i<4; ++i){
+        REQUIRE(bucketCumulants[i]==Approx(cumulants[i]));
+    }
+    const auto exactReport=cfdistutilities::computeBucketingReport(alpha, prec, loans, exactBuckets, xRange.first, xRange.second, numU);
+    REQUIRE(exactReport.numLoans==5000);
+    REQUIRE(std::abs(exactReport.changeInVaR)<.0001);
+    const auto buckets=cfdistutilities::bucketLoans(loans, cfdistutilities::BucketTolerance{.01, 0.0, 0.0});
+    REQUIRE(buckets.size()==17*7*5);
+    std::size_t count=0;
+    for(const auto& bucket:buckets){
+        count+=bucket.count;
+    }
+    REQUIRE(count==loans.size());
+    const auto report=cfdistutilities::computeBucketingReport(alpha, prec, loans, buckets, xRange.first, xRange.second, numU);
+    REQUIRE(report.numBuckets==buckets.size());
+    REQUIRE(report.bucketedVaR==Approx(report.exactVaR).epsilon(.001));
+    REQUIRE(report.changeInVaR==report.bucketedVaR-report.exactVaR);
+}
+TEST_CASE("Test risk contributions add up and match direct computation", "[CFDistUtilities]"){
+    std::vector<cfdistutilities::Loan> loans;
+    for(int i=0; i<2000; ++i){
+        loans.push_back(cfdistutilities::Loan{1.0+(i%17)*.5, .005+(i%7)*.004, .2+(i%5)*.15});
+    }
+    const int numU=512;
+    const double alpha=.01;
+    const double prec=.0000001;
+    const auto xRange=cfdistutilities::computePortfolioDomain(cfdistutilities::AutoDomain(12.0), loans);
+    const double xMin=xRange.first;
+    const double xMax=xRange.second;
+    const auto contributions=cfdistutilities::computeRiskContributions(alpha, prec, loans, xMin, xMax, numU);
+    const auto discreteCF=cfdistutilities::computePortfolioDiscreteCF(loans, xMin, xMax, numU);
+    const auto esAndVaR=cfdistutilities::computeESDiscrete(alpha, prec, xMin, xMax, discreteCF);
+    REQUIRE(contributions.var==Approx(std::get<cfdistutilities::VAR>(esAndVaR)));
+    REQUIRE(contributions.es==Approx(std::get<cfdistutilities::ES>(esAndVaR)));
+    const auto totalVaR=std::accumulate(contributions.varContributions.begin(), contributions.varContributions.end(), 0.0);
+    const auto totalES=std::accumulate(contributions.esContributions.begin(), contributions.esContributions.end(), 0.0);
+    REQUIRE(totalVaR==Approx(contributions.var).epsilon(.001));
+    REQUIRE(totalES==Approx(contributions.es).epsilon(.001));
+    //loan i contributes w_i*pd_i*P(X without loan i<=x*+w_i)/alpha to ES
+    const int position=5;
+    auto otherLoans=loans;
+    otherLoans.erase(otherLoans.begin()+position);
+    const double w=loans[position].exposure*loans[position].lgd;
+    const auto otherCDF=cfdistutilities::computeCDFAtPoint(-contributions.var+w, xMin, xMax, cfdistutilities::computePortfolioDiscreteCF(otherLoans, xMin, xMax, numU));
+    REQUIRE(w*loans[position].pd*otherCDF/alpha==Approx(contributions.esContributions[position]).epsilon(.0001));
+    const auto buckets=cfdistutilities::bucketLoans(loans);
+    const auto bucketContributions=cfdistutilities::computeRiskContributions(cfdistutilities::ParallelPolicy{2}, alpha, prec, buckets, xMin, xMax, numU);
+    REQUIRE(std::accumulate(bucketContributions.esContributions.begin(), bucketContributions.esContributions.end(), 0.0)==Approx(totalES));
+}
+TEST_CASE("Test scenario sweep", "[CFDistUtilities]"){
+    const int numU=256;
+    const double alpha=.01;
+    const double r=.004;
+    const double sigJ=.220094;
+    const double muJ=-.302967;
+    const double lambda=.204516;
+    const double speed=2.6726;
+    const double v0=.237187;
+    const double rho=-.182754;
+    const double T=.187689;
+    const double adaV=0;
+    double prec=.0000001;
+    std::vector<double> sigmas;
+    for(int i=0; i<40; ++i){
+        sigmas.push_back(.1+i*.02);
+    }
+    const auto computeScenarioES=[&](const double& sigma){
+        const double xMax=get_jump_diffusion_vol(sigma, lambda, muJ, sigJ, T)*5.0;
+        return cfdistutilities::computeES(alpha, prec, -xMax, xMax, numU, cf(r, T)(lambda, muJ, sigJ, sigma, v0, speed, adaV, rho));
+    };
+    const auto results=cfdistutilities::computeScenarios(cfdistutilities::ParallelPolicy{4}, sigmas, computeScenarioES);
+    REQUIRE(results.size()==sigmas.size());
+    for(std::size_t i=0; i<sigmas.size(); ++i){
+        REQUIRE(results[i].value==computeScenarioES(sigmas[i]));
+        REQUIRE(results[i].duration.count()>0);
+    }
+    std::vector<std::function<double()> > tasks;
+    for(const auto& sigma:sigmas){
+        tasks.push_back([=](){
+            return std::get<cfdistutilities::ES>(computeScenarioES(sigma));
+        });
+    }
+    tasks.push_back([](){
+        throw std::runtime_error("failed scenario");
+        return 0.0;
+    });
+    REQUIRE_THROWS_AS(cfdistutilities::computeScenarios(cfdistutilities::par, tasks), const std::runtime_error&);
+    tasks.pop_back();
+    const auto serialResults=cfdistutilities::computeScenarios(tasks);
+    for(std::size_t i=0; i<sigmas.size(); ++i){
+        REQUIRE(serialResults[i].value==std::get<cfdistutilities::ES>(results[i].value));
+    }
+}
+TEST_CASE("Test grid basis against computeCDF", "[CFDistUtilities]"){
+    const double mu=2;
+    const int numU=256;
+    const int numX=301;
+    const double xMin=-30;
+    const double xMax=35;
+    std::vector<std::vector<double> > discreteCFs;
+    for(int i=0; i<6; ++i){
+        const double sigma=3.0+i;
+        discreteCFs.push_back(fangoost::computeDiscreteCFReal(xMin, xMax, numU, [&](const auto& u){
+            return exp(u*mu+.5*u*u*sigma*sigma);
+        }));
+    }
+    const auto basis=cfdistutilities::computeGridBasis(numX, numU, xMin, xMax);
+    const auto cdfs=cfdistutilities::computeCDFs(basis, discreteCFs);
+    const auto expectations=cfdistutilities::computePartialExpectations(cfdistutilities::ParallelPolicy{2}, basis, discreteCFs);
+    REQUIRE(cdfs.size()==discreteCFs.size());
+    for(std::size_t i=0; i<discreteCFs.size(); ++i){
+        const auto cdf=cfdistutilities::computeCDF(numX, xMin, xMax, discreteCFs[i]);
+        const auto expectation=cfdistutilities::computePartialExpectation(numX, xMin, xMax, discreteCFs[i]);
+        for(int j=0; j<numX; ++j){
+            REQUIRE(std::abs(cdfs[i][j]-cdf[j])<1e-12);
+            REQUIRE(std::abs(expectations[i][j]-expectation[j])<1e-10);
+        }
+    }
+    //a discrete CF shorter than the basis is rejected rather than read past its end
+    discreteCFs[3].resize(numU-1);
+    REQUIRE_THROWS_AS(cfdistutilities::computeCDFs(basis, discreteCFs), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(cfdistutilities::computePartialExpectations(cfdistutilities::ParallelPolicy{2}, basis, discreteCFs), const std::invalid_argument&);
+}
+TEST_CASE("Test computeCDFAtPoints against computeCDFAtPoint", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    std::vector<double> xValues;
+    for(int i=0; i<37; ++i){
+        xValues.push_back(xMin+std::fmod(i*7.31, xMax-xMin));
+    }
+    const auto discreteCF=fangoost::computeDiscreteCFReal(xMin, xMax, numU, normCF);
+    const std::deque<double> discreteCFDeque(discreteCF.begin(), discreteCF.end());
+    const auto cdf=cfdistutilities::computeCDFAtPoints(xValues, xMin, xMax, discreteCF);
+    const auto parallelCDF=cfdistutilities::computeCDFAtPoints(cfdistutilities::ParallelPolicy{4}, xValues, numU, xMin, xMax, normCF);
+    const auto genericCDF=cfdistutilities::computeCDFAtPoints(xValues, xMin, xMax, discreteCFDeque);
+    const auto expectation=cfdistutilities::computePartialExpectationAtPoints(xValues, numU, xMin, xMax, normCF);
+    REQUIRE(cdf.size()==xValues.size());
+    for(std::size_t j=0; j<xValues.size(); ++j){
+        const auto evaluation=cfdistutilities::evaluatePoint(xValues[j], xMin, xMax, discreteCF);
+        REQUIRE(std::abs(cdf[j]-evaluation.cdf)<1e-13);
+        REQUIRE(std::abs(genericCDF[j]-evaluation.cdf)<1e-13);
+        REQUIRE(parallelCDF[j]==cdf[j]);
+        REQUIRE(std::abs(expectation[j]-evaluation.expectation)<1e-12);
+    }
+}
+TEST_CASE("Test batch CF against scalar CF", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    double prec=.0000001;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    const auto batchNormCF=cfdistutilities::makeBatchCF([&](const double* u, std::size_t n, double* real, double* imag){
+        for(std::size_t k=0; k<n; ++k){
+            const double modulus=exp(-.5*u[k]*u[k]*sigma*sigma);
+            real[k]=modulus*cos(mu*u[k]);
+            imag[k]=modulus*sin(mu*u[k]);
+        }
+    });
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    const auto batchDiscreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, batchNormCF);
+    const auto adaptedDiscreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, cfdistutilities::makeBatchCFFromScalar(normCF));
+    REQUIRE(batchDiscreteCF.size()==discreteCF.size());
+    for(int k=0; k<numU; ++k){
+        REQUIRE(std::abs(batchDiscreteCF[k]-discreteCF[k])<1e-14);
+        REQUIRE(std::abs(adaptedDiscreteCF[k]-discreteCF[k])<1e-14);
+    }
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, batchNormCF)==Approx(6.224268));
+    REQUIRE(std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, xMin, xMax, numU, batchNormCF))==Approx(8.313564).epsilon(.0001));
+    //a BatchCF cannot give the cumulants, so the cumulant bracket needs them passed in
+    const cfdistutilities::SolverOptions brent(cfdistutilities::RootMethod::brent);
+    cfdistutilities::SolverStats stats;
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, batchNormCF, brent)==Approx(6.224268));
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, batchNormCF, brent, stats)==Approx(6.224268));
+    REQUIRE(std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, xMin, xMax, numU, batchNormCF, brent))==Approx(8.313564).epsilon(.0001));
+    REQUIRE(std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, xMin, xMax, numU, batchNormCF, brent, stats))==Approx(8.313564).epsilon(.0001));
+    const cfdistutilities::SolverOptions cumulantBracket(cfdistutilities::RootMethod::brent, true);
+    REQUIRE_THROWS_AS(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, batchNormCF, cumulantBracket), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(cfdistutilities::computeES(alpha, prec, xMin, xMax, numU, batchNormCF, cumulantBracket), const std::invalid_argument&);
+    REQUIRE(cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, batchNormCF, cumulantBracket.withCumulants(cfdistutilities::computeCumulants(normCF)))==Approx(6.224268));
+    //the workspace overloads take a BatchCF too, and reuse its buffers
+    const int numX=1025;
+    const auto expectedCDF=cfdistutilities::computeCDF(numX, numU, xMin, xMax, normCF);
+    cfdistutilities::Workspace workspace;
+    cfdistutilities::computeCDF(workspace, numX, numU, xMin, xMax, batchNormCF);
+    const auto numAllocationsBefore=numAllocations.load();
+    const auto& workspaceCDF=cfdistutilities::computeCDF(workspace, numX, numU, xMin, xMax, batchNormCF);
+    const auto numAllocationsAfter=numAllocations.load();
+    REQUIRE(numAllocationsAfter==numAllocationsBefore);
+    REQUIRE(workspaceCDF.size()==expectedCDF.size());
+    for(int i=0; i<numX; ++i){
+        REQUIRE(std::abs(workspaceCDF[i]-expectedCDF[i])<1e-12);
+    }
+    const cfdistutilities::AdaptiveNumU adaptive(1e-10);
+    const auto adaptiveCF=cfdistutilities::computeDiscreteCF(xMin, xMax, adaptive, batchNormCF);
+    REQUIRE(cfdistutilities::computeDiscreteCF(xMin, xMax, adaptive, normCF).size()==adaptiveCF.size());
+}
+TEST_CASE("Test solver stats", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    const double alpha=.05;
+    double prec=.0000001;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    cfdistutilities::SolverStats stats;
+    const auto VaR=cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, normCF, stats);
+    REQUIRE(VaR==cfdistutilities::computeVaR(alpha, prec, xMin, xMax, numU, normCF));
+    REQUIRE(stats.cfEvaluations==numU);
+    REQUIRE(stats.numCoefficients==numU);
+    REQUIRE(stats.iterations>0);
+    REQUIRE(stats.bracketWidth>0.0);
+    REQUIRE(stats.bracketWidth<=(xMax-xMin)*std::pow(.5, stats.iterations-1));
+    REQUIRE(stats.discreteCFTime.count()>0);
+    REQUIRE(stats.solverTime.count()>0);
+    cfdistutilities::SolverStats esStats;
+    const auto esAndVaR=cfdistutilities::computeES(alpha, prec, cfdistutilities::autoDomain, numU, normCF, esStats);
+    REQUIRE(std::get<cfdistutilities::ES>(esAndVaR)==std::get<cfdistutilities::ES>(cfdistutilities::computeES(alpha, prec, cfdistutilities::autoDomain, numU, normCF)));
+    REQUIRE(esStats.cfEvaluations>numU);
+    REQUIRE(esStats.domainTime.count()>0);
+    cfdistutilities::SolverStats newtonStats;
+    const auto newtonVaR=cfdistutilities::computeVaRNewtonBisect(alpha, prec, prec, xMin, xMax, 0.0, numU, normCF, newtonStats);
+    REQUIRE(newtonVaR==Approx(VaR));
+    REQUIRE(newtonStats.iterations<stats.iterations);
+    cfdistutilities::SolverStats elStats;
+    REQUIRE(cfdistutilities::computeEL(xMin, xMax, numU, normCF, elStats)==Approx(mu));
+    REQUIRE(cfdistutilities::computeCDFAtPoint(4.0, numU, xMin, xMax, normCF, elStats)==Approx(.6554217));
+    REQUIRE(elStats.numCoefficients==2*numU);
+    cfdistutilities::SolverStats gridStats;
+    const auto cdf=cfdistutilities::computeCDF(46, numU, xMin, xMax, normCF, gridStats);
+    REQUIRE(cdf==cfdistutilities::computeCDF(46, numU, xMin, xMax, normCF));
+    REQUIRE(cdf[24]==Approx(.6554217));
+    REQUIRE(gridStats.numCoefficients==numU);
+    REQUIRE(gridStats.solverTime.count()>0);
+    const auto expectation=cfdistutilities::computePartialExpectation(cfdistutilities::ParallelPolicy{2}, 1025, cfdistutilities::AdaptiveNumU(1e-10), xMin, xMax, normCF, gridStats);
+    REQUIRE(expectation.back()==Approx(mu));
+    REQUIRE(gridStats.numCoefficients>numU);
+    cfdistutilities::SolverStats batchStats;
+    const std::vector<double> alphas({.01, .05, .1});
+    const auto batchVaR=cfdistutilities::computeVaRBatch(alphas, prec, xMin, xMax, numU, normCF, batchStats);
+    REQUIRE(batchVaR==cfdistutilities::computeVaRBatch(alphas, prec, xMin, xMax, numU, normCF));
+    REQUIRE(batchStats.cfEvaluations==numU);
+    REQUIRE(batchStats.iterations>0);
+    REQUIRE(batchStats.solverTime.count()>0);
+    const std::vector<double> xValues({-1.0, 4.0, 10.0});
+    cfdistutilities::SolverStats pointsStats;
+    const auto pointsCDF=cfdistutilities::computeCDFAtPoints(xValues, numU, xMin, xMax, normCF, pointsStats);
+    REQUIRE(pointsCDF==cfdistutilities::computeCDFAtPoints(xValues, numU, xMin, xMax, normCF));
+    REQUIRE(pointsCDF[1]==Approx(.6554217));
+    REQUIRE(pointsStats.numCoefficients==numU);
+    REQUIRE(pointsStats.solverTime.count()>0);
+    const auto pointsExpectation=cfdistutilities::computePartialExpectationAtPoints(cfdistutilities::ParallelPolicy{2}, xValues, numU, xMin, xMax, normCF, pointsStats);
+    REQUIRE(pointsExpectation==cfdistutilities::computePartialExpectationAtPoints(xValues, numU, xMin, xMax, normCF));
+    REQUIRE(pointsStats.numCoefficients==2*numU);
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    cfdistutilities::SolverStats discretePointsStats;
+    REQUIRE(cfdistutilities::computeCDFAtPoints(cfdistutilities::ParallelPolicy{2}, xValues, xMin, xMax, discreteCF, discretePointsStats)==pointsCDF);
+    REQUIRE(cfdistutilities::computePartialExpectationAtPoints(xValues, xMin, xMax, discreteCF, discretePointsStats)==pointsExpectation);
+    REQUIRE(discretePointsStats.cfEvaluations==0);
+    REQUIRE(discretePointsStats.solverTime.count()>0);
+    //without a guess the cumulants for the Cornish-Fisher guess count towards the domain stage
+    cfdistutilities::SolverStats guessStats;
+    REQUIRE(cfdistutilities::computeVaRNewton(alpha, prec, prec, xMin, xMax, numU, normCF, guessStats)==Approx(VaR));
+    REQUIRE(guessStats.cfEvaluations>numU);
+    REQUIRE(guessStats.domainTime.count()>0);
+    REQUIRE(guessStats.iterations>0);
+    cfdistutilities::SolverStats guessBisectStats;
+    REQUIRE(cfdistutilities::computeVaRNewtonBisect(alpha, prec, prec, xMin, xMax, numU, normCF, guessBisectStats)==Approx(VaR));
+    REQUIRE(guessBisectStats.cfEvaluations>numU);
+    REQUIRE(guessBisectStats.iterations>0);
+    cfdistutilities::SolverStats tableStats;
+    const cfdistutilities::QuantileTable table(1025, numU, xMin, xMax, normCF, tableStats);
+    REQUIRE(table.var(alpha)==cfdistutilities::QuantileTable(1025, numU, xMin, xMax, normCF).var(alpha));
+    REQUIRE(tableStats.cfEvaluations==numU);
+    REQUIRE(tableStats.solverTime.count()>0);
+    cfdistutilities::SolverStats discreteTableStats;
+    const cfdistutilities::QuantileTable discreteTable(1025, xMin, xMax, discreteCF, discreteTableStats);
+    REQUIRE(discreteTable.var(alpha)==table.var(alpha));
+    REQUIRE(discreteTableStats.solverTime.count()>0);
+}
+TEST_CASE("Test quantile table", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const int numX=4097;
+    const double xMin=-20;
+    const double xMax=25;
+    double prec=.0000001;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    const cfdistutilities::QuantileTable table(numX, numU, xMin, xMax, normCF);
+    REQUIRE(table.var(.05)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(table.var(.05, true)==Approx(6.224268).epsilon(.000001));
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    double previous=xMin;
+    for(int i=1; i<100; ++i){
+        const double alpha=i/100.0;
+        const double quantile=table.quantile(alpha);
+        REQUIRE(quantile>=previous);
+        previous=quantile;
+        REQUIRE(std::abs(quantile+cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF))<.0001);
+        REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(table.quantile(alpha, true), xMin, xMax, discreteCF)-alpha)<1e-9);
+    }
+    REQUIRE(table.quantile(0.0)>=xMin);
+    REQUIRE(table.quantile(1.0)<=xMax);
+}
+TEST_CASE("Test bracketing methods against bisection", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    double prec=.0000001;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    const cfdistutilities::SolverOptions brent(cfdistutilities::RootMethod::brent);
+    const cfdistutilities::SolverOptions itp(cfdistutilities::RootMethod::itp);
+    std::size_t bisectionIterations=0;
+    std::size_t itpIterations=0;
+    for(const double alpha:{.001, .01, .05, .5, .95}){
+        cfdistutilities::SolverStats bisectionStats;
+        cfdistutilities::SolverStats brentStats;
+        cfdistutilities::SolverStats itpStats;
+        const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, bisectionStats);
+        const auto brentVaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, brent, brentStats);
+        const auto itpVaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, itp, itpStats);
+        REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(-brentVaR, xMin, xMax, discreteCF)-alpha)<prec);
+        REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(-itpVaR, xMin, xMax, discreteCF)-alpha)<prec);
+        REQUIRE(brentVaR==Approx(VaR));
+        REQUIRE(itpVaR==Approx(VaR));
+        REQUIRE(brentStats.iterations<bisectionStats.iterations);
+        //ITP never takes more than one iteration more than bisection, besides the CDF at the ends of the bracket
+        REQUIRE(itpStats.iterations<=bisectionStats.iterations+2);
+        bisectionIterations+=bisectionStats.iterations;
+        itpIterations+=itpStats.iterations;
+    }
+    REQUIRE(itpIterations<bisectionIterations);
+    const auto ES=cfdistutilities::computeES(.05, prec, xMin, xMax, numU, normCF);
+    const auto brentES=cfdistutilities::computeES(.05, prec, xMin, xMax, numU, normCF, brent);
+    const auto itpES=cfdistutilities::computeES(.05, prec, cfdistutilities::autoDomain, numU, normCF, itp);
+    REQUIRE(std::get<cfdistutilities::ES>(brentES)==Approx(std::get<cfdistutilities::ES>(ES)));
+    REQUIRE(std::get<cfdistutilities::ES>(itpES)==Approx(std::get<cfdistutilities::ES>(ES)).epsilon(.0001));
+    REQUIRE(cfdistutilities::computeVaR(.05, prec, xMin, xMax, numU, normCF, brent)==Approx(6.224268).epsilon(.0001));
+    //alpha outside of the CDF on the domain cannot be bracketed, so bisection is used
+    REQUIRE(cfdistutilities::computeVaRDiscrete(1.5, prec, xMin, xMax, discreteCF, brent)==cfdistutilities::computeVaRDiscrete(1.5, prec, xMin, xMax, discreteCF));
+}
+TEST_CASE("Test Cornish-Fisher bracket", "[CFDistUtilities]"){
+    const double mu=2;
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    double prec=.0000001;
+    auto normCF=[&](const auto& u){ //normal distribution's CF
+        return exp(u*mu+.5*u*u*sigma*sigma);
+    };
+    const auto cumulants=cfdistutilities::computeCumulants(normCF);
+    //the expansion is exact for the normal distribution, up to the error of the normal quantile
+    REQUIRE(cfdistutilities::computeCornishFisherQuantile(.05, cumulants)==Approx(-6.224268).epsilon(.001));
+    REQUIRE(cfdistutilities::computeCornishFisherQuantile(.5, cumulants)==Approx(mu).epsilon(.001));
+    const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+    for(const auto method:{cfdistutilities::RootMethod::bisection, cfdistutilities::RootMethod::brent, cfdistutilities::RootMethod::itp}){
+        for(const double alpha:{.001, .01, .05, .95}){
+            cfdistutilities::SolverStats wholeDomainStats;
+            cfdistutilities::SolverStats cumulantStats;
+            const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, cfdistutilities::SolverOptions(method), wholeDomainStats);
+            const auto cumulantVaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, cfdistutilities::SolverOptions(method).withCumulants(cumulants), cumulantStats);
+            REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(-cumulantVaR, xMin, xMax, discreteCF)-alpha)<prec);
+            REQUIRE(cumulantVaR==Approx(VaR));
+            REQUIRE(cumulantStats.iterations<wholeDomainStats.iterations);
+        }
+    }
+    //the CF versions compute the cumulants themselves
+    const cfdistutilities::SolverOptions options(cfdistutilities::RootMethod::brent, true);
+    cfdistutilities::SolverStats stats;
+    REQUIRE(cfdistutilities::computeVaR(.05, prec, xMin, xMax, numU, normCF, options, stats)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(stats.cfEvaluations>numU);
+    REQUIRE(stats.iterations<7);
+    REQUIRE(std::get<cfdistutilities::ES>(cfdistutilities::computeES(.05, prec, cfdistutilities::autoDomain, numU, normCF, options))==Approx(std::get<cfdistutilities::ES>(cfdistutilities::computeES(.05, prec, xMin, xMax, numU, normCF))).epsilon(.0001));
+    //a cumulant estimate outside of the domain is moved inside
+    REQUIRE(cfdistutilities::computeVaRDiscrete(.05, prec, xMin, xMax, discreteCF, cfdistutilities::SolverOptions().withCumulants({{100.0, 1.0, 0.0, 0.0}}))==Approx(6.224268).epsilon(.0001));
+    REQUIRE(cfdistutilities::computeVaRNewton(.05, prec, prec, xMin, xMax, numU, normCF)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(cfdistutilities::computeVaRNewtonBisect(.05, prec, prec, xMin, xMax, numU, normCF)==Approx(6.224268).epsilon(.0001));
+}
+TEST_CASE("Test warm started VaR solver", "[CFDistUtilities]"){
+    const double sigma=5;
+    const int numU=256;
+    const double xMin=-20;
+    const double xMax=25;
+    double prec=.0000001;
+    cfdistutilities::VaRSolver solver(prec);
+    cfdistutilities::VaRSolver brentSolver(prec, cfdistutilities::SolverOptions(cfdistutilities::RootMethod::brent));
+    std::size_t coldIterations=0;
+    std::size_t warmIterations=0;
+    std::size_t brentIterations=0;
+    for(int day=0; day<20; ++day){
+        const double mu=2.0+.01*day;
+        auto normCF=[&](const auto& u){ //normal distribution's CF
+            return exp(u*mu+.5*u*u*sigma*sigma);
+        };
+        const auto discreteCF=cfdistutilities::computeDiscreteCF(xMin, xMax, numU, normCF);
+        for(const double alpha:{.01, .05}){
+            cfdistutilities::SolverStats coldStats;
+            cfdistutilities::SolverStats warmStats;
+            cfdistutilities::SolverStats brentStats;
+            const auto VaR=cfdistutilities::computeVaRDiscrete(alpha, prec, xMin, xMax, discreteCF, coldStats);
+            const auto warmVaR=solver.varDiscrete(alpha, xMin, xMax, discreteCF, warmStats);
+            const auto brentVaR=brentSolver.varDiscrete(alpha, xMin, xMax, discreteCF, brentStats);
+            REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(-warmVaR, xMin, xMax, discreteCF)-alpha)<prec);
+            REQUIRE(std::abs(cfdistutilities::computeCDFAtPoint(-brentVaR, xMin, xMax, discreteCF)-alpha)<prec);
+            REQUIRE(warmVaR==Approx(VaR));
+            REQUIRE(brentVaR==Approx(VaR));
+            if(day>0){
+                coldIterations+=coldStats.iterations;
+                warmIterations+=warmStats.iterations;
+                brentIterations+=brentStats.iterations;
+            }
+        }
+        if(day==19){
+            const auto esAndVaR=solver.es(.05, xMin, xMax, numU, normCF);
+            REQUIRE(std::get<cfdistutilities::ES>(esAndVaR)==Approx(std::get<cfdistutilities::ES>(cfdistutilities::computeES(.05, prec, xMin, xMax, numU, normCF))));
+            REQUIRE(solver.var(.05, xMin, xMax, numU, normCF)==Approx(std::get<cfdistutilities::VAR>(esAndVaR)));
+        }
+    }
+    REQUIRE(warmIterations<coldIterations);
+    REQUIRE(brentIterations<warmIterations);
+    solver.reset();
+    cfdistutilities::SolverStats stats;
+    auto normCF=[&](const auto& u){
+        return exp(u*2.0+.5*u*u*sigma*sigma);
+    };
+    REQUIRE(solver.var(.05, xMin, xMax, numU, normCF, stats)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(stats.iterations>10);
+    //a BatchCF warm starts the same way
+    const auto batchNormCF=cfdistutilities::makeBatchCFFromScalar(normCF);
+    cfdistutilities::VaRSolver batchSolver(prec, cfdistutilities::SolverOptions(cfdistutilities::RootMethod::brent));
+    cfdistutilities::SolverStats coldStats;
+    cfdistutilities::SolverStats warmStats;
+    REQUIRE(batchSolver.var(.05, xMin, xMax, numU, batchNormCF, coldStats)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(batchSolver.var(.05, xMin, xMax, numU, batchNormCF, warmStats)==Approx(6.224268).epsilon(.0001));
+    REQUIRE(warmStats.iterations<coldStats.iterations);
+    REQUIRE(std::get<cfdistutilities::ES>(batchSolver.es(.05, xMin, xMax, numU, batchNormCF))==Approx(8.313564).epsilon(.0001));
+    REQUIRE(std::get<cfdistutilities::ES>(batchSolver.es(.01, xMin, xMax, numU, batchNormCF, stats))==Approx(std::get<cfdistutilities::ES>(cfdistutilities::computeES(.01, prec, xMin, xMax, numU, normCF))));
+    REQUIRE(batchSolver.var(.01, xMin, xMax, numU, batchNormCF)==Approx(cfdistutilities::computeVaR(.01, prec, xMin, xMax, numU, normCF)));
+    cfdistutilities::VaRSolver cumulantSolver(prec, cfdistutilities::SolverOptions(cfdistutilities::RootMethod::brent, true));
+    REQUIRE_THROWS_AS(cumulantSolver.var(.05, xMin, xMax, numU, batchNormCF), const std::invalid_argument&);
+}